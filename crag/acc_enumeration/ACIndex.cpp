@@ -4,110 +4,112 @@
 
 #include "ACIndex.h"
 
+#include <limits>
+#include <numeric>
+
 ACIndex::ACIndex(const Config& c, std::shared_ptr<ACClasses> initial_classes)
- : current_version_(std::make_shared<Storage>(&versions_count_))
- , current_classes_version_(std::move(initial_classes))
- , pairs_to_add_(c.workers_count_ * 2)
+ : current_classes_version_(std::move(initial_classes))
+ , classes_updates_((c.workers_count_ + c.index_shards_) * 2)
+ , filter_fp_rate_(c.index_filter_fp_rate_)
+ , filter_bytes_(c.index_filter_bytes_ / c.index_shards_)
+ , layout_(c.index_layout_)
 {
-  auto initial_semaphore = versions_count_.tryWait();
-  assert(initial_semaphore);
-
-  index_updater_ = std::thread([this] {
-    while (true) {
-      std::deque<BatchStorage::first_type> new_batches;
-
-      BatchStorage next_batch;
-      if (!pairs_to_add_.Pop(next_batch)) {
-        // queue is closed
-        break;
-      }
-
-      std::shared_ptr<ACClasses> new_classes;
-      bool something_merged = false;
-
-      /* block of functions working with the new version of ACClasses */
-
-      auto MergeMany = [&new_classes, &something_merged, this](const BatchStorage::second_type& ids_to_merge) {
-        if (ids_to_merge.empty()) {
-          return;
-        }
-        if (!new_classes) {
-          new_classes = this->GetCurrentACClasses()->Clone();
-        }
-        for (auto&& ids : ids_to_merge) {
-          new_classes->Merge(ids.first, ids.second);
-        }
-        something_merged |= !ids_to_merge.empty();
-      };
+  if (layout_ == Config::IndexLayout::kHash) {
+    hash_ = std::make_unique<PairHashTable>();
+  }
+
+  while (shards_.size() < c.index_shards_) {
+    shards_.push_back(std::make_unique<Shard>(c.workers_count_ * 2));
+    auto& shard = *shards_.back();
+    shard.current_version_ = std::make_shared<Storage>(&shard.versions_count_);
+    auto initial_semaphore = shard.versions_count_.tryWait();
+    assert(initial_semaphore);
+  }
+
+  classes_updater_ = std::thread([this] {
+    UpdateClasses();
+  });
 
-      auto StoreNewClasses = [&new_classes, &something_merged, this]() {
-        if (new_classes && something_merged) {
-          new_classes->Normalize();
-        }
-        if (new_classes) {
-          std::atomic_store_explicit(&current_classes_version_, std::shared_ptr<const ACClasses>(std::move(new_classes)), std::memory_order_release);
-        }
-      };
+  for (auto&& shard : shards_) {
+    shard->updater_ = std::thread([this, shard = shard.get()] {
+      UpdateShard(shard);
+    });
+  }
+}
 
-      /* this is it for acc classes */
+void ACIndex::UpdateShard(Shard* shard) {
+  while (true) {
+    std::deque<std::deque<IndexValues>> new_batches;
 
-      versions_count_.wait();
+    BatchStorage next_batch;
+    if (!shard->batches_.Pop(next_batch)) {
+      // queue is closed
+      break;
+    }
 
-      do {
-        MergeMany(next_batch.second);
-        new_batches.push_back(std::move(next_batch.first));
-      } while (pairs_to_add_.TryPop(next_batch));
+    ClassesUpdate classes_update;
 
-      auto batches_size = std::accumulate(new_batches.begin(), new_batches.end(), 0u,
-        [](size_t sum, const BatchStorage::first_type& next) { return sum + next.size(); } );
+    if (!hash_) {
+      shard->versions_count_.wait();
+    }
 
-      if (batches_size == 0) {
-        StoreNewClasses();
+    do {
+      new_batches.push_back(std::move(next_batch.to_add_));
+      classes_update.parts_done_.push_back(next_batch.seq_);
+    } while (shard->batches_.TryPop(next_batch));
 
-        // we had a new version reserved, but actually did not
-        // create one
-        // hence we need to release one version
-        versions_count_.signal();
-        continue;
+    if (hash_) {
+      // the pairs which fit a key are inserted right away, only the rest goes to the sorted versions
+      for (auto&& batch : new_batches) {
+        auto long_pairs = std::stable_partition(batch.begin(), batch.end(), [](const IndexValues& item) {
+          return FitsPairKey(item.first);
+        });
+        hash_->Insert(batch.begin(), long_pairs,
+            [](const IndexValues& item) { return PackPair(item.first); },
+            [](const IndexValues& item) { return item.second; },
+            [&classes_update](const IndexValues& item, uint64_t existing) {
+              classes_update.to_merge_.emplace_back(static_cast<ACClasses::ClassId>(existing), item.second);
+            });
+        classes_update.to_add_.insert(classes_update.to_add_.end(), batch.begin(), long_pairs);
+        batch.erase(batch.begin(), long_pairs);
       }
 
-      // we may be updating the minimums in some classes, so create a new version
-      if (!new_classes) {
-        new_classes = GetCurrentACClasses()->Clone();
+      if (std::all_of(new_batches.begin(), new_batches.end(), [](const auto& batch) { return batch.empty(); })) {
+        classes_updates_.Push(std::move(classes_update));
+        continue;
       }
+      shard->versions_count_.wait();
+    }
 
-      // first we merge-sort new batches
-      std::vector<IndexValues> new_elements;
-      new_elements.reserve(batches_size);
-      for (auto&& batch : new_batches) {
-
-        // register adding pair to a class
-        for (auto&& pair : batch) {
-          new_classes->AddPair(pair.second, pair.first);
-        }
+    auto batches_size = std::accumulate(new_batches.begin(), new_batches.end(), 0u,
+      [](size_t sum, const std::deque<IndexValues>& next) { return sum + next.size(); } );
 
-        auto merged_end = new_elements.end();
-        new_elements.insert(merged_end, batch.begin(), batch.end());
-        std::inplace_merge(new_elements.begin(), merged_end, new_elements.end(), Storage::KeyLess);
-      }
+    // first we merge-sort new batches
+    std::vector<IndexValues> new_elements;
+    new_elements.reserve(batches_size);
+    for (auto&& batch : new_batches) {
+      auto merged_end = new_elements.end();
+      new_elements.insert(merged_end, batch.begin(), batch.end());
+      std::inplace_merge(new_elements.begin(), merged_end, new_elements.end(), Storage::KeyLess);
+    }
 
-      new_batches.clear();
+    new_batches.clear();
 
-      auto new_version = std::make_shared<Storage>(&versions_count_);
+    const auto& current_version = *shard->current_version_;
+    auto new_version = std::make_shared<Storage>(&shard->versions_count_);
 
-      auto& new_index = new_version->index_;
-      new_index.reserve(current_version_->index_.size() + batches_size);
-      std::merge(current_version_->index_.begin(), current_version_->index_.end(),
-          new_elements.begin(), new_elements.end(), std::back_inserter(new_index), Storage::KeyLess);
+    auto& new_index = new_version->index_;
+    new_index.reserve(current_version.index_.size() + batches_size);
+    std::merge(current_version.index_.begin(), current_version.index_.end(),
+        new_elements.begin(), new_elements.end(), std::back_inserter(new_index), Storage::KeyLess);
 
+    if (!new_index.empty()) {
       auto last_unique = new_index.begin();
 
-      assert(!new_index.empty());
-
       for(auto current = std::next(new_index.begin()); current != new_index.end(); ++current) {
         if (current->first == last_unique->first) {
           // 'remove' current and merge classes
-          new_classes->Merge(last_unique->second, current->second);
+          classes_update.to_merge_.emplace_back(last_unique->second, current->second);
         } else {
           ++last_unique;
           *last_unique = *current;
@@ -116,15 +118,124 @@ ACIndex::ACIndex(const Config& c, std::shared_ptr<ACClasses> initial_classes)
 
       ++last_unique;
       new_index.erase(last_unique, new_index.end());
+    }
 
-      std::atomic_store_explicit(&current_version_, std::move(new_version), std::memory_order_release);
-      StoreNewClasses();
+    UpdateFilter(current_version, new_version.get(), new_elements);
+    if (layout_ == Config::IndexLayout::kStaticBTree) {
+      new_version->tree_ = StaticSearchTree(new_index, [](const IndexValues& item) {
+        return PairOrderKey(item.first);
+      });
     }
-  });
+
+    std::atomic_store_explicit(&shard->current_version_, std::move(new_version), std::memory_order_release);
+
+    // the new pairs may update the minimums in their classes
+    classes_update.to_add_.insert(classes_update.to_add_.end(), new_elements.begin(), new_elements.end());
+    classes_updates_.Push(std::move(classes_update));
+  }
+}
+
+void ACIndex::UpdateClasses() {
+  while (true) {
+    ClassesUpdate next_update;
+    if (!classes_updates_.Pop(next_update)) {
+      // queue is closed
+      break;
+    }
+
+    auto new_classes = GetCurrentACClasses()->Clone();
+    std::vector<CommitSeq> parts_done;
+
+    do {
+      for (auto&& ids : next_update.to_merge_) {
+        new_classes->Merge(ids.first, ids.second);
+      }
+      for (auto&& pair : next_update.to_add_) {
+        new_classes->AddPair(pair.second, pair.first);
+      }
+      parts_done.insert(parts_done.end(), next_update.parts_done_.begin(), next_update.parts_done_.end());
+    } while (classes_updates_.TryPop(next_update));
+
+    std::atomic_store_explicit(&current_classes_version_, std::shared_ptr<const ACClasses>(std::move(new_classes)),
+                               std::memory_order_release);
+    MarkPartsDone(parts_done);
+  }
+
+  // wake up everyone who waits, nothing is going to be committed anymore
+  {
+    std::lock_guard<std::mutex> lock(commit_mutex_);
+    committed_seq_.store(std::numeric_limits<CommitSeq>::max(), std::memory_order_release);
+  }
+  commit_done_.notify_all();
+}
+
+void ACIndex::ExpectParts(CommitSeq seq, size_t parts_count) {
+  std::lock_guard<std::mutex> lock(commit_mutex_);
+  parts_left_[seq] = parts_count;
+}
+
+void ACIndex::MarkPartsDone(const std::vector<CommitSeq>& parts) {
+  {
+    std::lock_guard<std::mutex> lock(commit_mutex_);
+    for (auto seq : parts) {
+      auto parts_left = parts_left_.find(seq);
+      assert(parts_left != parts_left_.end());
+      if (--parts_left->second == 0) {
+        parts_left_.erase(parts_left);
+        committed_out_of_order_.insert(seq);
+      }
+    }
+    auto committed = committed_seq_.load(std::memory_order_relaxed);
+    while (!committed_out_of_order_.empty() && *committed_out_of_order_.begin() == committed + 1) {
+      ++committed;
+      committed_out_of_order_.erase(committed_out_of_order_.begin());
+    }
+    committed_seq_.store(committed, std::memory_order_release);
+  }
+  commit_done_.notify_all();
+}
+
+void ACIndex::UpdateFilter(const Storage& current_version, Storage* new_version,
+                           const std::vector<IndexValues>& new_elements) const {
+  if (filter_bytes_ == 0) {
+    return;
+  }
+
+  const auto& filter = current_version.filter_;
+  if (filter && (new_version->index_.size() <= filter->capacity()
+      || filter->BytesCount() + PairBloomFilter::kBlockBits / 8 > filter_bytes_)) {
+    // the readers of the current version may get more false positives, but never false negatives
+    for (auto&& element : new_elements) {
+      filter->Insert(PairFilterKey(element.first));
+    }
+    new_version->filter_ = filter;
+    return;
+  }
+
+  new_version->filter_ = std::make_shared<PairBloomFilter>(2 * new_version->index_.size(), filter_fp_rate_,
+                                                           filter_bytes_);
+  for (auto&& element : new_version->index_) {
+    new_version->filter_->Insert(PairFilterKey(element.first));
+  }
+}
+
+void ACIndex::WaitForCommit(CommitSeq seq) {
+  if (CommittedSeq() >= seq) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(commit_mutex_);
+  commit_done_.wait(lock, [&] { return CommittedSeq() >= seq; });
 }
 
 ACIndex::~ACIndex() {
-  pairs_to_add_.Close();
-  index_updater_.join();
+  for (auto&& shard : shards_) {
+    shard->batches_.Close();
+  }
+  for (auto&& shard : shards_) {
+    shard->updater_.join();
+  }
+  // the shard updaters have sent everything to the merge log
+  classes_updates_.Close();
+  classes_updater_.join();
 }
 
@@ -5,7 +5,14 @@
 #ifndef ACC_ACINDEX_H
 #define ACC_ACINDEX_H
 
+#include <condition_variable>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include <boost/optional.hpp>
 
 #include <crag/multithreading/sem.h>
 #include <crag/multithreading/SharedQueue.h>
@@ -13,8 +20,19 @@
 #include "acc_class.h"
 #include "config.h"
 #include "acc_classes.h"
+#include "index_search.h"
+#include "pair_bloom_filter.h"
+#include "pair_hash_table.h"
 
 //! Thread-safe version of an index which adds multiple items at once
+/**
+ * The pairs are spread over a few shards by a hash, every shard has its own sorted versions and its own updater,
+ * so the commits of different shards are merged in parallel. The updaters send the new pairs and the merges of the
+ * classes to a single thread, which applies them to ACClasses.
+ *
+ * With IndexLayout::kHash the pairs which fit PackPair are inserted by the updaters into a single PairHashTable
+ * instead, and only the longer ones are kept in the sorted versions.
+ */
 class ACIndex {
   struct Storage;
  public:
@@ -25,10 +43,31 @@ class ACIndex {
   ACIndex(const ACIndex&)=delete;
   ACIndex& operator=(const ACIndex&)=delete;
 
+  //! Counters of the lookups which went through the filter of the index
+  struct FilterStats {
+    size_t lookups = 0u;
+    size_t rejected = 0u; //!< The binary search was skipped
+    size_t false_positives = 0u; //!< The filter passed a pair which is not in the index
+
+    void MergeStats(const FilterStats& other) {
+      lookups += other.lookups;
+      rejected += other.rejected;
+      false_positives += other.false_positives;
+    }
+  };
+
   class DataReadHandle;
-  DataReadHandle GetData() const {
-    return DataReadHandle(std::shared_ptr<const Storage>(std::atomic_load_explicit(&current_version_,
-                                                                                   std::memory_order_acquire)));
+  //! The lookups through the handle are counted in @p filter_stats, which should not be shared with other threads
+  DataReadHandle GetData(FilterStats* filter_stats = nullptr) const {
+    std::vector<std::shared_ptr<const Storage>> data;
+    data.reserve(shards_.size());
+    for (auto&& shard : shards_) {
+      data.emplace_back(std::atomic_load_explicit(&shard->current_version_, std::memory_order_acquire));
+    }
+    if (hash_) {
+      return DataReadHandle(std::move(data), hash_->GetView(), hash_->size(), filter_stats);
+    }
+    return DataReadHandle(std::move(data), boost::none, 0u, filter_stats);
   }
 
   std::shared_ptr<const ACClasses> GetCurrentACClasses() {
@@ -37,9 +76,28 @@ class ACIndex {
 
   class AddBatch;
   AddBatch NewBatch() {
-    return AddBatch(&pairs_to_add_);
+    return AddBatch(this);
+  }
+
+  //! Every executed batch gets the next number, the data of batch n is visible once the commit n is done
+  using CommitSeq = uint64_t;
+
+  //! The number of the last executed batch
+  CommitSeq SubmittedSeq() const {
+    return submitted_seq_.load(std::memory_order_acquire);
+  }
+
+  //! All batches up to this one are visible through GetData() and GetCurrentACClasses() in all shards
+  CommitSeq CommittedSeq() const {
+    return committed_seq_.load(std::memory_order_acquire);
   }
 
+  //! Blocks until the batch @p seq and all before it are visible, or the index is closed
+  /**
+   * Should not be called while holding a DataReadHandle, since the updater may wait for it to be released
+   */
+  void WaitForCommit(CommitSeq seq);
+
  private:
   struct Storage {
     crag::multithreading::DefaultSemaphoreType *copies_count_;
@@ -47,6 +105,12 @@ class ACIndex {
     using ItemType = std::pair<ACPair, ACClasses::ClassId>;
     std::vector<ItemType> index_;
 
+    //! All pairs of index_ are in it, the newer versions may share it and add their pairs, nullptr if disabled
+    std::shared_ptr<PairBloomFilter> filter_;
+
+    //! Static B-tree over PairOrderKey of index_, empty unless IndexLayout::kStaticBTree
+    StaticSearchTree tree_;
+
     static bool KeyLess(const ItemType &lhs, const ItemType &rhs) {
       return lhs.first < rhs.first;
     }
@@ -70,30 +134,93 @@ class ACIndex {
   using IndexValues = typename std::remove_reference<decltype(*std::declval<Storage>().index_.begin())>::type;
   using ToMerge = std::pair<ACClasses::ClassId, ACClasses::ClassId>;
 
-  using BatchStorage = std::pair<std::deque<IndexValues>, std::vector<ToMerge>>;
+  //! The pairs of a batch which go to a single shard
+  struct BatchStorage {
+    CommitSeq seq_ = 0u;
+    std::deque<IndexValues> to_add_;
+  };
   using BatchesQueue = crag::multithreading::SharedQueue<BatchStorage>;
+
+  //! The record of the merge log, which is applied to ACClasses
+  struct ClassesUpdate {
+    std::vector<CommitSeq> parts_done_; //!< A batch is committed once all its parts are applied
+    std::vector<ToMerge> to_merge_;
+    std::vector<IndexValues> to_add_; //!< The minimal pairs of the classes are updated with them
+  };
+  using ClassesUpdatesQueue = crag::multithreading::SharedQueue<ClassesUpdate>;
+
+  struct Shard {
+    explicit Shard(size_t queue_size)
+        : batches_(queue_size) {}
+
+    std::shared_ptr<Storage> current_version_; // shared between all threads
+    BatchesQueue batches_;
+    crag::multithreading::DefaultSemaphoreType
+        versions_count_{2}; // don't allow more than two versions exist to limit memory usage
+    std::thread updater_;
+  };
+
+  //! The shard which keeps @p p
+  static size_t ShardOf(const ACPair &p, size_t shards_count) {
+    // not the hash of the filter, so that the pairs of a shard are spread over all blocks of its filter
+    return static_cast<size_t>((((PairFilterKey(p) * 0x9E3779B97F4A7C15ull) >> 32u) * shards_count) >> 32u);
+  }
  public:
   class AddBatch {
    public:
-    void Execute() {
+    //! Sends the data to the updaters and returns the number of the last batch sent by this one, 0 if none
+    CommitSeq Execute() {
       if (!to_add_.empty() || !to_merge_.empty()) {
         if (!sorted_and_unique_) {
           std::stable_sort(to_add_.begin(), to_add_.end(), Storage::KeyLess);
+          // the same pair may be pushed with different classes, which should then be merged
+          for (auto current = to_add_.begin(); current != to_add_.end(); ++current) {
+            auto next = std::next(current);
+            if (next != to_add_.end() && Storage::KeyEq(*current, *next)) {
+              Merge(current->second, next->second);
+            }
+          }
           to_add_.erase(std::unique(to_add_.begin(), to_add_.end(), Storage::KeyEq), to_add_.end());
         }
-        commit_to_->Push(BatchStorage(std::piecewise_construct, std::make_tuple(std::move(to_add_)),
-                                      std::make_tuple(std::move(to_merge_))));
+        auto shards_count = index_->shards_.size();
+        std::vector<std::deque<IndexValues>> parts(shards_count);
+        if (shards_count == 1) {
+          parts.front() = std::move(to_add_);
+        } else {
+          // every part stays sorted
+          for (auto&& item : to_add_) {
+            parts[ShardOf(item.first, shards_count)].push_back(std::move(item));
+          }
+        }
+
+        auto parts_count = static_cast<size_t>(std::count_if(parts.begin(), parts.end(), [](const auto& part) {
+          return !part.empty();
+        }));
+        parts_count += to_merge_.empty() ? 0u : 1u;
+
+        last_seq_ = index_->submitted_seq_.fetch_add(1, std::memory_order_acq_rel) + 1;
+        index_->ExpectParts(last_seq_, parts_count);
+        for (size_t shard = 0; shard < shards_count; ++shard) {
+          if (!parts[shard].empty()) {
+            index_->shards_[shard]->batches_.Push(BatchStorage{last_seq_, std::move(parts[shard])});
+          }
+        }
+        if (!to_merge_.empty()) {
+          index_->classes_updates_.Push(ClassesUpdate{{last_seq_}, std::move(to_merge_), {}});
+        }
       }
       to_add_.clear();
       to_merge_.clear();
+      sorted_and_unique_ = true;
+      return last_seq_;
     }
 
     ~AddBatch() {
       Execute();
     }
 
-    AddBatch(BatchesQueue *commit_to)
-        : commit_to_(commit_to) {}
+    AddBatch(ACIndex *index)
+        : index_(index) {}
 
     void Push(ACPair p, ACClasses::ClassId c) {
       if (!to_add_.empty() && to_add_.back().first >= p) {
@@ -108,67 +235,222 @@ class ACIndex {
         to_merge_.emplace_back(first, second);
       }
     }
+
+    bool empty() const {
+      return to_add_.empty() && to_merge_.empty();
+    }
+
+    size_t PairsCount() const {
+      return to_add_.size();
+    }
+
+    size_t MergesCount() const {
+      return to_merge_.size();
+    }
+
+    //! Memory taken by the pushed data, approximately
+    size_t BytesCount() const {
+      return to_add_.size() * sizeof(IndexValues) + to_merge_.size() * sizeof(ToMerge);
+    }
    private:
     bool sorted_and_unique_ = true;
     std::deque<IndexValues> to_add_;
     std::vector<std::pair<ACClasses::ClassId, ACClasses::ClassId>> to_merge_;
-    BatchesQueue *commit_to_;
+    ACIndex *index_;
+    CommitSeq last_seq_ = 0u;
   };
 
   class DataReadHandle {
    public:
-    auto begin() const {
-      return data_->index_.begin();
-    }
-
-    auto end() const {
-      return data_->index_.end();
+    //! The class of @p p, if it is in the index
+    boost::optional<ACClasses::ClassId> find(const ACPair &p) const {
+      if (hashed_ && FitsPairKey(p)) {
+        return hashed_->Find(PackPair(p));
+      }
+      const auto &data = *data_[ShardOf(p, data_.size())];
+      if (FilteredOut(data, p)) {
+        return boost::none;
+      }
+      const auto *items = data.index_.data();
+      const auto *items_end = items + data.index_.size();
+      const auto *pos = data.tree_.empty() ? PrefetchingLowerBound(items, items_end, p, Storage::KeyLessVal)
+                                           : TreeLowerBound(data, p);
+      if (pos == items_end || pos->first != p) {
+        CountFalsePositive(data);
+        return boost::none;
+      }
+      return pos->second;
     }
 
-    auto find(const ACPair &p) const {
-      auto pos = std::lower_bound(begin(), end(), p, Storage::KeyLessVal);
-      if (pos == end() || pos->first != p) {
-        return end();
+    //! Looks up all pairs of the sorted range [@p first, @p last) in one pass over the index
+    /**
+     * The elements of the range are either pairs or (pair, something) with the pair first, like the ones pushed
+     * to AddBatch. @p callback(query, class) is called for every element in order, with class being the same as find()
+     * would return. If the callback returns false, the lookup stops.
+     *
+     * Every search starts where the previous one in the same shard stopped and makes exponentially growing steps
+     * until it passes the pair, and the next probe is prefetched while the current one is compared. So a batch
+     * of k pairs takes O(k log(n/k)) comparisons instead of O(k log n), and the probes near the previous position
+     * are already cached. With the static B-tree layout every pair is searched in the tree instead, and with the hash
+     * one it is just looked up. The pairs rejected by the filter are not searched at all.
+     */
+    template <typename Iterator, typename Callback>
+    void FindSorted(Iterator first, Iterator last, Callback&& callback) const {
+      std::vector<const Item*> positions;
+      positions.reserve(data_.size());
+      for (auto&& data : data_) {
+        positions.push_back(data->index_.data());
+      }
+      for (; first != last; ++first) {
+        const ACPair& pair = QueryPair(*first);
+        if (hashed_ && FitsPairKey(pair)) {
+          if (!callback(first, hashed_->Find(PackPair(pair)))) {
+            return;
+          }
+          continue;
+        }
+        auto shard = ShardOf(pair, data_.size());
+        const auto &data = *data_[shard];
+        boost::optional<ACClasses::ClassId> pair_class;
+        if (!FilteredOut(data, pair)) {
+          const auto *items_end = data.index_.data() + data.index_.size();
+          auto &position = positions[shard];
+          position = data.tree_.empty() ? GallopingLowerBound(position, items_end, pair, Storage::KeyLessVal)
+                                        : TreeLowerBound(data, pair);
+          if (position != items_end && position->first == pair) {
+            pair_class = position->second;
+          } else {
+            CountFalsePositive(data);
+          }
+        }
+        if (!callback(first, pair_class)) {
+          return;
+        }
       }
-      return pos;
     }
 
     size_t count(const ACPair &p) const {
-      return find(p) == end() ? 0u : 1u;
+      return find(p) ? 1u : 0u;
     }
 
-    auto at(const ACPair &p) {
-      auto pos = find(p);
-      if (pos == end()) {
+    ACClasses::ClassId at(const ACPair &p) const {
+      auto pair_class = find(p);
+      if (!pair_class) {
         throw std::out_of_range("Pair is not in index");
       }
-      return pos->second;
+      return *pair_class;
     }
 
     size_t size() const {
-      return data_->index_.size();
+      size_t size = hashed_size_;
+      for (auto&& data : data_) {
+        size += data->index_.size();
+      }
+      return size;
+    }
+
+    //! Memory taken by the filters of this version
+    size_t FilterBytes() const {
+      size_t bytes = 0;
+      for (auto&& data : data_) {
+        bytes += data->filter_ ? data->filter_->BytesCount() : 0u;
+      }
+      return bytes;
     }
 
     void release() {
-      data_.reset();
+      data_.clear();
+      hashed_ = boost::none;
     }
 
-    DataReadHandle(std::shared_ptr<const Storage> data)
-        : data_(std::move(data)) {}
+    DataReadHandle(std::vector<std::shared_ptr<const Storage>> data, boost::optional<PairHashTable::View> hashed,
+                   size_t hashed_size, FilterStats* filter_stats = nullptr)
+        : data_(std::move(data))
+        , hashed_(std::move(hashed))
+        , hashed_size_(hashed_size)
+        , filter_stats_(filter_stats) {}
 
    private:
-    std::shared_ptr<const Storage> data_;
+    std::vector<std::shared_ptr<const Storage>> data_; //!< The current versions of all shards
+    boost::optional<PairHashTable::View> hashed_; //!< With IndexLayout::kHash
+    size_t hashed_size_;
+    FilterStats* filter_stats_;
+
+    using Item = Storage::ItemType;
+
+    //! True if the filter of the shard @p data is sure that @p p is not in it
+    bool FilteredOut(const Storage &data, const ACPair &p) const {
+      if (!data.filter_) {
+        return false;
+      }
+      auto rejected = !data.filter_->MayContain(PairFilterKey(p));
+      if (filter_stats_) {
+        ++filter_stats_->lookups;
+        filter_stats_->rejected += rejected;
+      }
+      return rejected;
+    }
+
+    void CountFalsePositive(const Storage &data) const {
+      if (data.filter_ && filter_stats_) {
+        ++filter_stats_->false_positives;
+      }
+    }
+
+    static const ACPair& QueryPair(const ACPair& p) {
+      return p;
+    }
+
+    template <typename Value>
+    static const ACPair& QueryPair(const std::pair<ACPair, Value>& p) {
+      return p.first;
+    }
+
+    static const Item *TreeLowerBound(const Storage &data, const ACPair &p) {
+      const auto *items = data.index_.data();
+      return data.tree_.LowerBound(items, items + data.index_.size(), PairOrderKey(p), p, Storage::KeyLessVal);
+    }
   };
 
  private:
-  std::shared_ptr<Storage> current_version_; // shared between all threads
+  std::vector<std::unique_ptr<Shard>> shards_;
+
   std::shared_ptr<const ACClasses> current_classes_version_; // shared between all threas as well
+  ClassesUpdatesQueue classes_updates_;
+
+  std::atomic<CommitSeq> submitted_seq_{0u};
+  std::atomic<CommitSeq> committed_seq_{0u};
+  std::map<CommitSeq, size_t> parts_left_; //!< The parts of the batches which are not applied yet
+  std::set<CommitSeq> committed_out_of_order_; //!< The batches may be pushed not in the order of their numbers
+  std::mutex commit_mutex_;
+  std::condition_variable commit_done_;
+
+  //! Called before the batch @p seq is split into @p parts_count parts and sent
+  void ExpectParts(CommitSeq seq, size_t parts_count);
+
+  //! Called by the updater of the classes when the parts of the batches @p parts are visible
+  void MarkPartsDone(const std::vector<CommitSeq>& parts);
+
+  double filter_fp_rate_;
+  size_t filter_bytes_; //!< Of a single shard
+  Config::IndexLayout layout_;
+  std::unique_ptr<PairHashTable> hash_; //!< With IndexLayout::kHash
+
+  //! Adds @p new_elements to the filter of @p current_version and shares it with @p new_version
+  /**
+   * A new filter with twice the room is built from all pairs once the current one is full, unless it
+   * can't grow because of the memory limit
+   */
+  void UpdateFilter(const Storage& current_version, Storage* new_version,
+                    const std::vector<IndexValues>& new_elements) const;
+
+  //! Merges the batches of @p shard into its new versions until the queue of the shard is closed
+  void UpdateShard(Shard* shard);
 
-  BatchesQueue pairs_to_add_;
-  crag::multithreading::DefaultSemaphoreType
-      versions_count_{2}; // don't allow more than two versions exist to limit memory usage
+  //! Applies the merge log to the new versions of ACClasses until its queue is closed
+  void UpdateClasses();
 
-  std::thread index_updater_;
+  std::thread classes_updater_;
 };
 
 #endif //ACC_ACINDEX_H
@@ -81,6 +81,16 @@ class ACPairProcessQueue {
     return result;
   }
 
+  //! Same as Pop(), but returns false at once if there is no task right now
+  bool TryPop(Value& next) {
+    auto result = output_queue_.TryPop(next);
+    if (result) {
+      input_queue_.Push(Message::Popped);
+      state_dump_->DumpPairQueueState(next.first, ACStateDump::PairQueueState::Popped);
+    }
+    return result;
+  }
+
   void Push(ACPair pair, bool is_aut_normalized) {
     state_dump_->DumpPairQueueState(pair, is_aut_normalized ? ACStateDump::PairQueueState::AutoNormalized : ACStateDump::PairQueueState::Pushed);
     tasks_to_do_.fetch_add(1, std::memory_order_relaxed);
@@ -5,11 +5,14 @@
 #include "ACWorker.h"
 
 #include <chrono>
+#include <mutex>
+#include <numeric>
 #include <regex>
 
 #include "acc_class.h"
 #include "ACIndex.h"
 #include "ACWorkerStats.h"
+#include "convert_byte_count.h"
 
 #include <boost/thread/locks.hpp>
 #include <boost/thread/shared_mutex.hpp>
@@ -17,6 +20,7 @@
 #include <crag/folded_graph/complete.h>
 #include <crag/folded_graph/folded_graph.h>
 #include <crag/folded_graph/harvest.h>
+#include <crag/pair_filters/pair_filters.h>
 
 using namespace crag;
 
@@ -25,11 +29,33 @@ struct WorkersSharedState {
   ACClasses::ClassId trivial_class;
   ACWorkerStats* worker_stats;
 
+  //! Every worker runs its own copy, the stats are merged back when it is done
+  PairFilters pair_filters;
+  CommitStats commit_stats;
+  ACIndex::FilterStats index_filter_stats;
+  std::mutex pair_filters_mutex;
+
   std::atomic<size_t> processed_count{0u};
   std::atomic<std::chrono::system_clock::time_point> last_report{std::chrono::system_clock::now()};
   std::atomic<std::chrono::system_clock::time_point> last_full_report{std::chrono::system_clock::now()};
 };
 
+static PairFilters ProcessFilters(const Config& config) {
+  PairFilters filters;
+  filters.Add("short_pair", [](const CWordTuple<2>& pair, CWordTuple<2>*) {
+    // pair is certainly trivial
+    return Length(pair) < 13 || pair[0].size() < 4 ? PairFilters::Verdict::kSkip : PairFilters::Verdict::kPass;
+  });
+  // AC-moves keep the group, so the abelianisation check of AddTrivialPresentationFilters is never useful here
+  if (config.use_pair_filters_) {
+    AddCommonSubwordFilter(&filters);
+  }
+  if (config.use_conjugation_length_filter_) {
+    AddConjugationLengthFilter(&filters);
+  }
+  return filters;
+}
+
 static Endomorphism ToIdentityImageMapping(const ACClass::AutKind k) {
   switch (k) {
     case ACClass::AutKind::Ident:
@@ -44,8 +70,8 @@ static Endomorphism ToIdentityImageMapping(const ACClass::AutKind k) {
   assert(false);
 }
 
-static Endomorphism ToIdentityImageMapping(const ACClass* c) {
-  return ToIdentityImageMapping(c->init_kind());
+static Endomorphism ToIdentityImageMapping(const ACClass& c) {
+  return ToIdentityImageMapping(c.init_kind());
   assert(false);
 }
 
@@ -53,15 +79,30 @@ struct ACWorker {
  public:
   ACWorker(WorkersSharedState* state)
       : state_(state)
+      , filters_(state->pair_filters)
+      , pending_(state->data.ac_index->NewBatch())
   {
     worker_thread_ = std::thread([this] {
       std::pair<ACPair, bool> next_task;
-      while(!state_->data.terminator.ShouldTerminate()
-        && state_->data.queue->Pop(next_task)) {
+      while(!state_->data.terminator.ShouldTerminate()) {
+        if (!state_->data.queue->TryPop(next_task)) {
+          // the other workers may be waiting for the pairs kept here
+          Commit();
+          if (!state_->data.queue->Pop(next_task)) {
+            break;
+          }
+        }
         Process(next_task.first, next_task.second);
         state_->data.dump->DumpPairQueueState(next_task.first, ACStateDump::PairQueueState::Processed);
-        state_->data.queue->TaskDone();
+        ++pending_done_;
+        CommitIfWindowIsFull();
       }
+      Commit();
+
+      std::lock_guard<std::mutex> lock(state_->pair_filters_mutex);
+      state_->pair_filters.MergeStats(filters_);
+      state_->commit_stats.MergeStats(commit_stats_);
+      state_->index_filter_stats.MergeStats(index_filter_stats_);
     });
   }
 
@@ -71,8 +112,53 @@ struct ACWorker {
 
  private:
   WorkersSharedState* state_;
+  PairFilters filters_;
+
+  //! The changes of the index and the new tasks are sent at once, in a group commit
+  /**
+   * The new tasks are pushed only after their pairs are sent to the index, and the processed ones are reported done
+   * only after that, so that the queue doesn't get empty while some tasks are pending here.
+   */
+  ACIndex::AddBatch pending_;
+  std::vector<std::pair<ACPair, bool>> pending_tasks_;
+  size_t pending_done_ = 0u;
+  ClickTimer::Clock::time_point pending_since_;
+  CommitStats commit_stats_;
+  ACIndex::FilterStats index_filter_stats_;
+
   std::thread worker_thread_;
 
+  //! Schedules a new task, it is pushed to the queue on the next Commit()
+  void Schedule(ACPair pair, bool is_aut_normalized) {
+    pending_tasks_.emplace_back(std::move(pair), is_aut_normalized);
+  }
+
+  void CommitIfWindowIsFull() {
+    const auto& config = state_->data.config;
+    if (pending_.PairsCount() + pending_.MergesCount() >= config.commit_pairs_
+        || pending_.BytesCount() >= config.commit_bytes_
+        || ClickTimer::Clock::now() - pending_since_ >= std::chrono::milliseconds(config.commit_window_ms_)) {
+      Commit();
+    }
+  }
+
+  //! Sends everything pending to the index and the queue
+  void Commit() {
+    auto now = ClickTimer::Clock::now();
+    if (!pending_.empty()) {
+      commit_stats_.Add(pending_.PairsCount(), pending_.MergesCount(), now - pending_since_);
+      pending_.Execute();
+    }
+    for (auto&& task : pending_tasks_) {
+      state_->data.queue->Push(task.first, task.second);
+    }
+    pending_tasks_.clear();
+    for (; pending_done_ > 0; --pending_done_) {
+      state_->data.queue->TaskDone();
+    }
+    pending_since_ = now;
+  }
+
   struct ACStepInfo {
     ACClasses::ClassId class_id;
     bool use_automorphisms;
@@ -81,32 +167,26 @@ struct ACWorker {
     unsigned short complete_count;
     std::shared_ptr<const ACClasses> classes;
     ACIndex::DataReadHandle index;
-    ACIndex::AddBatch index_writer;
-
-    ~ACStepInfo() {
-      // this has to be in specific order since Execute may not proceed
-      // if queue is too long and it will be long if index folds a reference to the current
-      // version
-      index.release();
-      classes.reset();
-      index_writer.Execute();
-    }
+    ACIndex::AddBatch& index_writer; //!< The pending batch of the worker, which is committed after the step
   };
 
   ACStepInfo GetPairInfo(const ACPair& p) {
     while (true) {
-      auto index = state_->data.ac_index->GetData();
-      auto pair_class_pos = index.find(p);
-      if (pair_class_pos == index.end()) {
-        // it is possible that some index modifications are not committed yet
-        std::this_thread::yield();
+      auto index = state_->data.ac_index->GetData(&index_filter_stats_);
+      auto pair_class = index.find(p);
+      if (!pair_class) {
+        // the pair is pushed to the queue only after its batch is executed, so it is enough to wait for all batches
+        index.release();
+        state_->data.ac_index->WaitForCommit(state_->data.ac_index->SubmittedSeq());
         continue;
       }
 
       auto classes = state_->data.ac_index->GetCurrentACClasses();
-      auto pair_class_id = pair_class_pos->second;
+      auto pair_class_id = *pair_class;
 
-      auto batch = state_->data.ac_index->NewBatch();
+      if (pending_.empty() && pending_tasks_.empty() && pending_done_ == 0) {
+        pending_since_ = ClickTimer::Clock::now();
+      }
       return ACStepInfo{
           pair_class_id,
           classes->AllowsAutMoves(pair_class_id),
@@ -115,7 +195,7 @@ struct ACWorker {
           2,
           std::move(classes),
           std::move(index),
-          std::move(batch)
+          pending_
       };
     }
   }
@@ -135,11 +215,11 @@ struct ACWorker {
 
     auto in_index = index.find(reduced_pair);
 
-    if (in_index != index.end()) {
+    if (in_index) {
       //reduced pair was or will be harvested
       //so we will only need to merge classes
       state_->data.dump->DumpAutomorphEdge(pair, reduced_pair, false);
-      return in_index->second;
+      return in_index;
     }
 
     return boost::none;
@@ -195,8 +275,24 @@ struct ACWorker {
     if (harvest_limit + v.size() > kMaxTotalPairLength) {
       harvest_limit = kMaxTotalPairLength - v.size();
     }
+
+    //some graphs have orders of magnitude more cycles than the others of the same size, so the limit is decreased
+    //until the estimated harvest fits into the budget, but u itself is always harvested
     stats->HarvestClick();
-    auto harvested_words = Harvest(harvest_limit, 1, &g);
+    const auto harvest_budget = static_cast<double>(state_->data.config.harvest_budget_);
+    auto harvest_estimate = 0.;
+    if (harvest_budget > 0) {
+      auto closed_walks = EstimateClosedWalks(g, harvest_limit);
+      harvest_estimate = std::accumulate(closed_walks.begin() + 1, closed_walks.end(), 0.);
+      while (harvest_limit > u.size() && harvest_estimate > harvest_budget) {
+        harvest_estimate -= closed_walks[harvest_limit];
+        --harvest_limit;
+      }
+    }
+    stats->SetHarvestEstimate(static_cast<size_t>(harvest_estimate));
+    stats->SetCappedHarvestLimit(harvest_limit);
+
+    auto harvested_words = HarvestLeastRotations(harvest_limit, 1, &g);
     stats->HarvestClick();
     stats->SetHarvestedPairs(harvested_words.size());
 
@@ -215,7 +311,7 @@ struct ACWorker {
       auto to_identity_mapping = ToIdentityImageMapping(original_class);
 
       auto pushClass = [&](const Endomorphism& e, ACClass::AutKind type) {
-        if (type != ACClass::AutKind::Ident && identity_image_class->AllowsAutomorphism(type)) {
+        if (type != ACClass::AutKind::Ident && identity_image_class.AllowsAutomorphism(type)) {
           // the identity class is always considered primary
           // so if original_class is already merged with identity_image
           // then we add the new pairs to identity_image
@@ -224,7 +320,7 @@ struct ACWorker {
         }
 
         automorphic_classes.emplace_back(to_identity_mapping.ComposeWith(e),
-                                         classes.at(identity_image_id + static_cast<size_t>(type))->id_);
+                                         classes.at(identity_image_id + static_cast<size_t>(type)).id_);
       };
 
       thread_local auto ident = Endomorphism(CWord("x"), CWord("y"));
@@ -308,23 +404,22 @@ struct ACWorker {
     std::sort(new_tuples.begin(), new_tuples.end());
     auto tuples_end = std::unique(new_tuples.begin(), new_tuples.end());
 
-    auto new_tuple = new_tuples.begin();
-    auto new_tuples_keep = new_tuple;
+    auto new_tuples_keep = new_tuples.begin();
 
-    stats->SetUniquePairs(static_cast<size_t>(tuples_end - new_tuple));
+    stats->SetUniquePairs(static_cast<size_t>(tuples_end - new_tuples_keep));
 
-    while (new_tuple != tuples_end) {
-      auto exists = step_info.index.find(new_tuple->first);
-      if (exists != step_info.index.end()) {
+    // both the tuples and the index are sorted, so all of them are looked up in one pass
+    step_info.index.FindSorted(new_tuples.begin(), tuples_end, [&](auto new_tuple, auto exists) {
+      if (exists) {
         //we merge two ac classes
-        if (exists->second != new_tuple->second) {
-          auto first = step_info.classes->at(exists->second)->id_;
-          auto second = step_info.classes->at(new_tuple->second)->id_;
+        if (*exists != new_tuple->second) {
+          auto first = step_info.classes->at(*exists).id_;
+          auto second = step_info.classes->at(new_tuple->second).id_;
 
           if (first == state_->trivial_class
               || second == state_->trivial_class) {
             step_data->got_trivial_class = true;
-            return;
+            return false;
           }
 
           if (first != second) {
@@ -336,7 +431,11 @@ struct ACWorker {
         *new_tuples_keep = *new_tuple;
         ++new_tuples_keep;
       }
-      ++new_tuple;
+      return true;
+    });
+
+    if (step_data->got_trivial_class) {
+      return;
     }
 
     new_tuples.erase(new_tuples_keep, new_tuples.end());
@@ -402,34 +501,34 @@ struct ACWorker {
                       state_->data.queue->GetTasksCount(),
                       state_->data.ac_index->GetData().size());
 
-      std::map<crag::CWord::size_type, size_t> lengths_counts;
-      auto distinct_count = 0u;
+      // the statistics are maintained by ACClasses, so only the reported classes are visited
       auto ac_classes = state_->data.ac_index->GetCurrentACClasses();
-      for (auto&& c : *ac_classes) {
-        if (c.IsPrimary()) {
-          ++distinct_count;
-          ++lengths_counts[c.minimal_[0].size() + c.minimal_[1].size()];
-        }
-      }
+      auto distinct_count = ac_classes->DistinctCount();
 
       new_stats.write("Distinct classes: {}\n", distinct_count);
 
       if (distinct_count < 100) {
-        for (auto&& c : *ac_classes) {
-          if (c.IsPrimary()) {
-            c.DescribeForLog(&new_stats);
-            new_stats.write("\n");
-          }
+        std::vector<ACClasses::ClassId> primary;
+        for (crag::CWord::size_type length = 0; length <= ACClasses::kMaxPairLength; ++length) {
+          auto of_length = ac_classes->ClassesOfLength(length);
+          primary.insert(primary.end(), of_length.begin(), of_length.end());
+        }
+        std::sort(primary.begin(), primary.end());
+        for (auto&& id : primary) {
+          ac_classes->DescribeForLog(id, &new_stats);
+          new_stats.write("\n");
         }
       } else {
-        for (auto&& length : lengths_counts) {
-          new_stats.write("Length {}: {}\n", length.first, length.second);
-          if (full_report && length.second < 50) {
-            for (auto&& c : *ac_classes) {
-              if (c.IsPrimary() && c.minimal_[0].size() + c.minimal_[1].size() == length.first) {
-                c.DescribeForLog(&new_stats);
-                new_stats.write("\n");
-              }
+        for (crag::CWord::size_type length = 0; length <= ACClasses::kMaxPairLength; ++length) {
+          auto count = ac_classes->CountOfLength(length);
+          if (count == 0) {
+            continue;
+          }
+          new_stats.write("Length {}: {}\n", length, count);
+          if (full_report && count < 50) {
+            for (auto&& id : ac_classes->ClassesOfLength(length)) {
+              ac_classes->DescribeForLog(id, &new_stats);
+              new_stats.write("\n");
             }
           }
         }
@@ -499,19 +598,39 @@ struct ACWorker {
     auto MarkAsTrivial = [&]() {
       auto identity_class = ACClasses::IdentityImageFor(pair_info.class_id);
 
-      pair_info.index_writer.Merge(pair_info.classes->at(identity_class)->id_, state_->trivial_class);
-      pair_info.index_writer.Merge(pair_info.classes->at(identity_class + 1)->id_, state_->trivial_class);
-      pair_info.index_writer.Merge(pair_info.classes->at(identity_class + 2)->id_, state_->trivial_class);
-      pair_info.index_writer.Merge(pair_info.classes->at(identity_class + 3)->id_, state_->trivial_class);
+      pair_info.index_writer.Merge(pair_info.classes->at(identity_class).id_, state_->trivial_class);
+      pair_info.index_writer.Merge(pair_info.classes->at(identity_class + 1).id_, state_->trivial_class);
+      pair_info.index_writer.Merge(pair_info.classes->at(identity_class + 2).id_, state_->trivial_class);
+      pair_info.index_writer.Merge(pair_info.classes->at(identity_class + 3).id_, state_->trivial_class);
     };
 
     if (pair_info.is_trivial) {
       MarkAsTrivial();
       return ProcessedStats(pair);
     }
-    if (Length(pair) < 13 || pair[0].size() < 4) {
-      // pair is certainly trivial
-      return ProcessedStats(pair);
+
+    CWordTuple<2> reduced_pair;
+    switch (filters_(pair, &reduced_pair)) {
+      case PairFilters::Verdict::kPass:
+        break;
+      case PairFilters::Verdict::kSkip:
+        return ProcessedStats(pair);
+      case PairFilters::Verdict::kReduced: {
+        if (Length(reduced_pair) < 13 || reduced_pair[0].size() < 4) {
+          MarkAsTrivial();
+          return ProcessedStats(pair);
+        }
+
+        //the smaller pair is processed instead of this one
+        auto in_index = pair_info.index.find(reduced_pair);
+        if (in_index) {
+          pair_info.index_writer.Merge(*in_index, pair_info.class_id);
+        } else {
+          pair_info.index_writer.Push(reduced_pair, pair_info.class_id);
+          Schedule(reduced_pair, false);
+        }
+        return ProcessedStats(pair);
+      }
     }
 
     if (pair_info.use_automorphisms && !was_aut_normalized) {
@@ -563,17 +682,16 @@ struct ACWorker {
 
     //schedule obtained words
     {
-      auto& to_process = state_->data.queue;
       if (step_data.pairs_to_process.empty()) {
         // happens when we work with non-automorphic case
         for (auto&& p : step_data.pairs_to_add) {
           assert(!pair_info.use_automorphisms);
-          to_process->Push(p.first, false);
+          Schedule(p.first, false);
         }
       } else {
         assert(pair_info.use_automorphisms);
         for (auto&& pair_to_process : step_data.pairs_to_process) {
-          to_process->Push(pair_to_process, true);
+          Schedule(pair_to_process, true);
         }
       }
     }
@@ -594,6 +712,7 @@ void Process(const ACTasksData& data) {
   });
 
   WorkersSharedState state{data, data.ac_index->GetData().at(ACPair{CWord("x"), CWord("y")}), &worker_stats};
+  state.pair_filters = ProcessFilters(data.config);
 
   std::deque<ACWorker> workers;
   while(workers.size() < data.config.workers_count_) {
@@ -606,5 +725,24 @@ void Process(const ACTasksData& data) {
 
   auto final_stats = data.config.ofstream(data.config.run_stats(), std::ios::app);
   fmt::print(final_stats, "Processed {} pairs\n", state.processed_count);
+  const auto& commits = state.commit_stats;
+  if (commits.commits != 0) {
+    fmt::print(final_stats, "Commits: {}, {:.1f} pairs and {:.1f} merges on average, at most {} pairs, "
+                            "latency {:.3f}ms on average, {:.3f}ms at most\n",
+               commits.commits, static_cast<double>(commits.pairs) / commits.commits,
+               static_cast<double>(commits.merges) / commits.commits, commits.max_pairs,
+               std::chrono::duration<double, std::milli>(commits.total_latency).count() / commits.commits,
+               std::chrono::duration<double, std::milli>(commits.max_latency).count());
+  }
+  const auto& index_filter = state.index_filter_stats;
+  if (index_filter.lookups != 0) {
+    fmt::print(final_stats, "Index filter: {}/{} rejected, {} false positives, {} in use\n", index_filter.rejected,
+               index_filter.lookups, index_filter.false_positives,
+               ToHumanReadableByteCount(data.ac_index->GetData().FilterBytes()));
+  }
+  for (auto&& filter : state.pair_filters.stats()) {
+    fmt::print(final_stats, "Filter {}: {}/{} hits, {:.3f}s\n", filter.name, filter.hits, filter.calls,
+               std::chrono::duration<double>(filter.time).count());
+  }
 }
 
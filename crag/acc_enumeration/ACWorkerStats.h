@@ -8,6 +8,7 @@
 #include <thread>
 #include "acc_class.h"
 #include "boost_filtering_stream.h"
+#include "config.h"
 #include "stopwatch.h"
 #include <crag/multithreading/SharedQueue.h>
 
@@ -43,7 +44,7 @@ struct MoveStats {
     return total_time.Click();
   }
 
-  std::array<size_t, 7> num_stats{};
+  std::array<size_t, 9> num_stats{};
   static constexpr char stats_order[] =
       "graph_size, "
       "graph_modulus, "
@@ -51,7 +52,9 @@ struct MoveStats {
       "harvested_pairs, "
       "unique_pairs, "
       "aut_orbits_size, "
-      "added_pairs";
+      "added_pairs, "
+      "harvest_estimate, "
+      "capped_harvest_limit";
 
   void SetGraphSize(size_t s) {
     num_stats[0] = s;
@@ -80,6 +83,41 @@ struct MoveStats {
   auto GetAddedPairs() const {
     return num_stats[6];
   }
+  //! Zero if there is no harvest budget, then the walks are not estimated
+  void SetHarvestEstimate(size_t s) {
+    num_stats[7] = s;
+  }
+  void SetCappedHarvestLimit(size_t s) {
+    num_stats[8] = s;
+  }
+};
+
+//! Group commits of the pairs and merges of a worker to the index
+struct CommitStats {
+  size_t commits = 0u;
+  size_t pairs = 0u;
+  size_t merges = 0u;
+  size_t max_pairs = 0u;
+  ClickTimer::Duration total_latency{}; //!< From the first change in a batch till the batch is sent
+  ClickTimer::Duration max_latency{};
+
+  void Add(size_t batch_pairs, size_t batch_merges, ClickTimer::Duration latency) {
+    ++commits;
+    pairs += batch_pairs;
+    merges += batch_merges;
+    max_pairs = std::max(max_pairs, batch_pairs);
+    total_latency += latency;
+    max_latency = std::max(max_latency, latency);
+  }
+
+  void MergeStats(const CommitStats& other) {
+    commits += other.commits;
+    pairs += other.pairs;
+    merges += other.merges;
+    max_pairs = std::max(max_pairs, other.max_pairs);
+    total_latency += other.total_latency;
+    max_latency = std::max(max_latency, other.max_latency);
+  }
 };
 
 struct ACWorkerStats {
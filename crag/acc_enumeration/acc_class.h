@@ -6,25 +6,76 @@
 #define ACC_ACC_CLASS_H
 
 #include <bitset>
-#include <fstream>
-#include <map>
-#include <ostream>
+#include <cassert>
+#include <cstdint>
 
-#include <crag/folded_graph/complete.h>
 #include <crag/compressed_word/tuple_normal_form.h>
-#include <crag/disjoint_subsets/disjoint_subsets.h>
-
-#include "acc_class.h"
-#include "config.h"
 
 typedef crag::CWordTuple<2> ACPair;
 
-struct ACStateDump;
-struct ACClasses;
+//! Pairs of total length at most this one are packed into a single 64-bit key
+static constexpr crag::CWord::size_type kMaxPackedPairLength = 26u;
+
+inline bool FitsPairKey(const ACPair& p) {
+  return p.length() <= kMaxPackedPairLength;
+}
+
+//! 64-bit key of a pair which fits, the keys are ordered as the pairs are
+/**
+ * The total length takes the top bits, then goes the length of the first word and the letters of both words
+ * one after another, which is the same order as ACPair::operator< uses.
+ */
+inline uint64_t PackPair(const ACPair& p) {
+  assert(FitsPairKey(p));
+  auto first = p[0].GetDump();
+  auto second = p[1].GetDump();
+  return (static_cast<uint64_t>(p.length()) << 57u) | (static_cast<uint64_t>(first.length) << 52u)
+      | (first.letters << (2u * second.length)) | second.letters;
+}
+
+inline ACPair UnpackPair(uint64_t key) {
+  auto length = static_cast<crag::CWord::size_type>(key >> 57u);
+  auto first_length = static_cast<crag::CWord::size_type>((key >> 52u) & 0x1Fu);
+  auto second_length = static_cast<crag::CWord::size_type>(length - first_length);
+  auto letters = key & ((1ull << 52u) - 1);
+  return ACPair{crag::CWord(crag::CWord::Dump{first_length, letters >> (2u * second_length)}),
+                crag::CWord(crag::CWord::Dump{second_length, letters & ((1ull << (2u * second_length)) - 1)})};
+}
+
+//! The finalizer of MurmurHash3, spreads the packed keys over all bits, since they are far from uniform
+inline uint64_t MixPairKey(uint64_t key) {
+  key ^= key >> 33u;
+  key *= 0xFF51AFD7ED558CCDull;
+  key ^= key >> 33u;
+  key *= 0xC4CEB9FE1A85EC53ull;
+  key ^= key >> 33u;
+  return key;
+}
+
+//! 64-bit key of any pair which keeps the order: p < q implies PairOrderKey(p) <= PairOrderKey(q)
+/**
+ * It is PackPair(p) for the pairs which fit. For the longer ones it is the total length, the length of the first
+ * word and the first letters of both words, so only the long pairs may share a key.
+ */
+inline uint64_t PairOrderKey(const ACPair& p) {
+  if (FitsPairKey(p)) {
+    return PackPair(p);
+  }
+  auto first = p[0].GetDump();
+  auto second = p[1].GetDump();
+  // the letters of both words, aligned to the top bit
+  auto first_bits = 2u * first.length;
+  auto second_bits = 2u * second.length;
+  uint64_t letters = first_bits == 0 ? 0u : first.letters << (64u - first_bits);
+  if (first_bits < 64u && second_bits != 0) {
+    letters |= second_bits + first_bits <= 64u ? second.letters << (64u - first_bits - second_bits)
+                                               : second.letters >> (first_bits + second_bits - 64u);
+  }
+  return (static_cast<uint64_t>(p.length()) << 57u) | (static_cast<uint64_t>(first.length) << 51u) | (letters >> 13u);
+}
 
+//! Snapshot of a single class, ACClasses keeps the data of all classes in a few compact arrays
 struct ACClass {
-  ACPair initial_;
-
   enum class AutKind : int {
     Ident = 0, //!< The original pair
     x_xy  = 1, //!< x->xy
@@ -32,38 +83,18 @@ struct ACClass {
     y_Y   = 3, //!< y->Y
   };
 
+  size_t id_; //!< Index amond ACClasses
+  ACPair initial_; //!< The input pair, the class is started from its image under init_kind()
+  ACPair minimal_;
+  std::bitset<4> aut_types_;
+
   AutKind init_kind() const {
     return AutKind (id_ % 4);
   }
 
-  std::bitset<4> aut_types_;
-
   bool AllowsAutomorphism(ACClass::AutKind type) const {
     return aut_types_.test(static_cast<size_t>(type));
   }
-
-  ACPair minimal_;
-
-  /**
-   * Initially ``this``, but points to the current canonical representative among all merged classed
-   */
-  size_t merged_with_;
-
-  size_t id_; //!< Index amond ACClasses
-  ACStateDump* logger_;
-
-  size_t pairs_count_ = 0u;
-
-  //! Simple way to print the state of the class, single-line
-  void DescribeForLog(std::ostream* out) const;
-  void DescribeForLog(fmt::MemoryWriter* out) const;
-
-  bool IsPrimary() const {
-    return merged_with_ == id_;
-  }
-
-  ACClass(size_t id, ACPair initial, ACPair image, AutKind kind, ACStateDump* logger);
-  // class is trivially copyable & movable
 };
 
 
@@ -5,20 +5,179 @@
 #include "ACIndex.h"
 #include "acc_classes.h"
 
+#include <algorithm>
 #include <regex>
 #include <crag/compressed_word/endomorphism.h>
 
 using namespace crag;
 
+constexpr ACClasses::Index ACClasses::kNoClass;
+
+void ACClasses::DescribeForLog(ClassId id, std::ostream* out) const {
+  if (id >= size()) {
+    throw std::out_of_range("No class with such id");
+  }
+  auto c = Snapshot(id);
+  *out << id << ": " << c.initial_ << "(";
+  switch(c.init_kind()) {
+    case ACClass::AutKind::Ident:
+      *out << "Id";
+      break;
+    case ACClass::AutKind::x_xy:
+      *out << "x->xy";
+      break;
+    case ACClass::AutKind::x_y:
+      *out << "x<->y";
+      break;
+    case ACClass::AutKind::y_Y:
+      *out << "y->Y";
+      break;
+  }
+  *out << "): ";
+  if (!IsPrimary(id)) {
+    *out << "=> " << CanonicalOf(id);
+  } else {
+    *out << c.minimal_ << ", " << c.aut_types_;
+  }
+}
+
+void ACClasses::DescribeForLog(ClassId id, fmt::MemoryWriter *out) const {
+  if (id >= size()) {
+    throw std::out_of_range("No class with such id");
+  }
+  auto c = Snapshot(id);
+  out->write("{}: {}(", id, c.initial_);
+  switch (c.init_kind()) {
+    case ACClass::AutKind::Ident:
+      out->write("Id");
+      break;
+    case ACClass::AutKind::x_xy:
+      *out << "x->xy";
+      break;
+    case ACClass::AutKind::x_y:
+      *out << "x<->y";
+      break;
+    case ACClass::AutKind::y_Y:
+      *out << "y->Y";
+      break;
+  }
+
+  if (!IsPrimary(id)) {
+    out->write("): => {}", CanonicalOf(id));
+  } else {
+    out->write("): {}, {}", c.minimal_, c.aut_types_);
+  }
+}
+
+ACClass ACClasses::Snapshot(ClassId id) const {
+  return ACClass{id, initial_[IdentityImageFor(id) / 4], MinimalOf(static_cast<Index>(id)),
+                 AutTypes(static_cast<Index>(id))};
+}
+
+uint64_t ACClasses::MinimalKey(const ACPair& pair) {
+  if (FitsPairKey(pair)) {
+    return PackPair(pair);
+  }
+  long_minimals_.push_back(pair);
+  return kLongKey | (long_minimals_.size() - 1);
+}
+
+void ACClasses::SetMinimal(Index id, const ACPair& pair) {
+  auto key = static_cast<const Pages<uint64_t>&>(minimal_)[id];
+  if ((key & kLongKey) != 0 && !FitsPairKey(pair)) {
+    long_minimals_[key & ~kLongKey] = pair;
+  } else {
+    minimal_[id] = MinimalKey(pair);
+  }
+}
+
+ACPair ACClasses::MinimalOf(Index id) const {
+  auto key = minimal_[id];
+  if (key & kLongKey) {
+    return long_minimals_[key & ~kLongKey];
+  }
+  return UnpackPair(key);
+}
+
+bool ACClasses::MinimalKeyLess(uint64_t first, uint64_t second) const {
+  if (((first & second) & kLongKey) == 0) {
+    return first < second;
+  }
+  return long_minimals_[first & ~kLongKey] < long_minimals_[second & ~kLongKey];
+}
+
+crag::CWord::size_type ACClasses::MinimalLength(Index id) const {
+  auto key = minimal_[id];
+  if (key & kLongKey) {
+    return static_cast<CWord::size_type>(long_minimals_[key & ~kLongKey].length());
+  }
+  return static_cast<CWord::size_type>(key >> 57u);
+}
+
+void ACClasses::LinkToLength(Index id) {
+  auto length = MinimalLength(id);
+  ++length_counts_[length];
+  ++distinct_count_;
+
+  auto head = length_heads_[length];
+  length_next_[id] = head;
+  length_prev_[id] = kNoClass;
+  if (head != kNoClass) {
+    length_prev_[head] = id;
+  }
+  length_heads_[length] = id;
+}
+
+void ACClasses::UnlinkFromLength(Index id) {
+  auto length = MinimalLength(id);
+  --length_counts_[length];
+  --distinct_count_;
+
+  const auto& next_of = static_cast<const Pages<Index>&>(length_next_);
+  const auto& prev_of = static_cast<const Pages<Index>&>(length_prev_);
+  auto next = next_of[id];
+  auto prev = prev_of[id];
+  if (prev != kNoClass) {
+    length_next_[prev] = next;
+  } else {
+    length_heads_[length] = next;
+  }
+  if (next != kNoClass) {
+    length_prev_[next] = prev;
+  }
+}
+
+std::vector<ACClasses::ClassId> ACClasses::ClassesOfLength(crag::CWord::size_type length) const {
+  std::vector<ClassId> result;
+  result.reserve(CountOfLength(length));
+  for (auto id = length_heads_[length]; id != kNoClass; id = length_next_[id]) {
+    result.push_back(id);
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
 void ACClasses::AddClass(const ACPair& a) {
   thread_local auto x_xy = Endomorphism(CWord("xy"), CWord("y"));
   thread_local auto x_y = Endomorphism(CWord("y"), CWord("x"));
   thread_local auto y_Y = Endomorphism(CWord("x"), CWord("Y"));
 
-  classes_.emplace_back(classes_.size(), a, a, ACClass::AutKind::Ident, logger_);
-  classes_.emplace_back(classes_.size(), a, Apply(x_xy, a), ACClass::AutKind::x_xy, logger_);
-  classes_.emplace_back(classes_.size(), a, Apply(x_y, a), ACClass::AutKind::x_y, logger_);
-  classes_.emplace_back(classes_.size(), a, Apply(y_Y, a), ACClass::AutKind::y_Y, logger_);
+  initial_.push_back(a);
+  for (auto&& image : {a, Apply(x_xy, a), Apply(x_y, a), Apply(y_Y, a)}) {
+    auto id = static_cast<Index>(size());
+    auto minimal = ConjugationInverseFlipNormalForm(image);
+    minimal_.push_back(MinimalKey(minimal));
+    aut_types_.push_back(1u);
+    canonical_.push_back(id);
+    next_in_subset_.push_back(id);
+    merged_.Add();
+    length_next_.push_back(kNoClass);
+    length_prev_.push_back(kNoClass);
+    LinkToLength(id);
+
+    logger_->DumpPairClass(minimal, id);
+    logger_->NewMinimum(id, minimal);
+  }
 }
 
 void ACClasses::RestoreMerges() {
@@ -62,66 +221,91 @@ void ACClasses::RestoreMinimums() {
 }
 
 void ACClasses::Merge(ACClasses::ClassId first_id, ACClasses::ClassId second_id) {
-  auto first = at(first_id);
-  assert(first->IsPrimary());
-
-  auto second = at(second_id);
-  assert(second->IsPrimary());
+  auto first_root = merged_.Find(static_cast<Index>(first_id));
+  auto second_root = merged_.Find(static_cast<Index>(second_id));
 
-  if (first == second) {
+  if (first_root == second_root) {
     return;
   }
 
-  if (first->id_ > second->id_) {
+  auto first = Canonical(first_root);
+  auto second = Canonical(second_root);
+  if (first > second) {
     std::swap(first, second);
   }
 
-  second->merged_with_ = first->id_;
+  auto root = merged_.Merge(first_root, second_root);
+  auto merged_root = root == first_root ? second_root : first_root;
+  canonical_[root] = first;
+
+  // only the groups of the smaller subset may have got all their members merged, its list is walked before the splice
+  auto member = merged_root;
+  do {
+    UpdateAutTypes(member);
+    member = NextInSubset(member);
+  } while (member != merged_root);
+
+  // splice the cyclic lists of the members
+  std::swap(next_in_subset_[root], next_in_subset_[merged_root]);
 
   //update minimal and aut_type
-  if (second->minimal_ < first->minimal_) {
-    first->minimal_ = second->minimal_;
+  UnlinkFromLength(second);
+  const auto& minimal = static_cast<const Pages<uint64_t>&>(minimal_);
+  if (MinimalKeyLess(minimal[second], minimal[first])) {
+    UnlinkFromLength(first);
+    SetMinimal(first, MinimalOf(second));
+    LinkToLength(first);
   }
 
-  first->aut_types_ |= second->aut_types_;
-  first->pairs_count_ += second->pairs_count_;
+  aut_types_[first] |= AutTypes(second).to_ulong();
+
+  logger_->Merge(first, second);
+}
 
-  logger_->Merge(*first, *second);
+void ACClasses::UpdateAutTypes(Index id) {
+  auto original = static_cast<Index>(IdentityImageFor(id));
+  auto root = merged_.Find(original);
+  for (auto i = 1u; i < 4; ++i) {
+    if (merged_.Find(original + i) == root) {
+      // make sure it is allowed for the canonical
+      aut_types_[Canonical(root)] |= 1u << i;
+    }
+  }
 }
 
 void ACClasses::AddPair(ACClasses::ClassId id, ACPair pair) {
-  ACClass* canonical = at(id);
+  if (id >= size()) {
+    throw std::out_of_range("No class with such id");
+  }
+  auto canonical = Canonical(merged_.Find(static_cast<Index>(id)));
 
-  logger_->DumpPairClass(pair, *canonical);
-  canonical->pairs_count_ += 1;
+  logger_->DumpPairClass(pair, canonical);
 
-  if (pair < canonical->minimal_) {
-    canonical->minimal_ = pair;
-    logger_->NewMinimum(*canonical, pair);
+  if (pair < MinimalOf(canonical)) {
+    UnlinkFromLength(canonical);
+    SetMinimal(canonical, pair);
+    LinkToLength(canonical);
+    logger_->NewMinimum(canonical, pair);
   }
 }
 
 void ACClasses::InitACIndex(ACIndex* index) {
-  std::map<ACPair, ACClass*> pairs_classes;
-  for (auto&& c : classes_) {
-    auto was_inserted = pairs_classes.emplace(minimal_in(c.id_), &c);
+  std::map<ACPair, ClassId> pairs_classes;
+  for (ClassId id = 0; id < size(); ++id) {
+    auto was_inserted = pairs_classes.emplace(minimal_in(id), id);
     if (!was_inserted.second) {
-      Merge(c.id_, was_inserted.first->second->id_);
+      Merge(id, was_inserted.first->second);
     }
   }
 
   auto initial_batch = index->NewBatch();
 
   for (auto&& p : pairs_classes) {
-    initial_batch.Push(p.first, p.second->id_);
+    initial_batch.Push(p.first, p.second);
   }
 
-  initial_batch.Execute();
-
   // make sure data is committed
-  while (index->GetData().size() < pairs_classes.size()) {
-    std::this_thread::yield();
-  }
+  index->WaitForCommit(initial_batch.Execute());
 }
 
 
@@ -5,18 +5,38 @@
 #ifndef ACC_ACC_CLASSES_H
 #define ACC_ACC_CLASSES_H
 
+#include <array>
+#include <iterator>
 #include <map>
+#include <stdexcept>
+
+#include <crag/disjoint_subsets/disjoint_sets.h>
 
 #include "acc_class.h"
+#include "cow_paged_vector.h"
 #include "state_dump.h"
 #include "config.h"
 
 class ACIndex;
+
+//! All classes of pairs known so far
+/**
+ * The data is kept in the copy-on-write pages, so Clone() is cheap and a new version copies only the pages touched
+ * by the modifications. Hence all reads which don't modify anything should go through the const methods.
+ *
+ * Every field of the classes has an array of its own: the 4 classes of an input share a single initial pair, the
+ * minimal pairs are stored as the keys of PackPair(), the forest has 32-bit indices and the automorphisms take a byte.
+ * The minimums which are too long for a key are kept aside, see MinimalKey(). ACClass is only a snapshot of these.
+ *
+ * The statistics of the canonical classes are updated on every modification, so the reports don't scan all classes.
+ */
 class ACClasses {
  public:
   ACClasses(const Config &c, ACStateDump *logger)
       : config_(c)
-      , logger_(logger) {}
+      , logger_(logger) {
+    length_heads_.fill(kNoClass);
+  }
 
   std::shared_ptr<ACClasses> Clone() const {
     auto result = std::make_shared<ACClasses>(*this);
@@ -46,63 +66,93 @@ class ACClasses {
 
   void InitACIndex(ACIndex *index);;
 
-  std::vector<ACClass>::iterator
-  begin() {
-    return classes_.begin();
-  }
+  //! Iterates over the snapshots of all classes, canonical or not
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = ACClass;
+    using difference_type = ptrdiff_t;
+    using pointer = const ACClass*;
+    using reference = ACClass;
+
+    const_iterator(const ACClasses* classes, ClassId id)
+        : classes_(classes)
+        , id_(id)
+    { }
+
+    ACClass operator*() const {
+      return classes_->Snapshot(id_);
+    }
+
+    const_iterator& operator++() {
+      ++id_;
+      return *this;
+    }
+
+    bool operator==(const const_iterator& other) const {
+      return id_ == other.id_;
+    }
+
+    bool operator!=(const const_iterator& other) const {
+      return id_ != other.id_;
+    }
 
-  std::vector<ACClass>::const_iterator
-  begin() const {
-    return classes_.begin();
+   private:
+    const ACClasses* classes_;
+    ClassId id_;
+  };
+
+  const_iterator begin() const {
+    return const_iterator(this, 0);
   }
 
-  std::vector<ACClass>::iterator
-  end() {
-    return classes_.end();
+  const_iterator end() const {
+    return const_iterator(this, size());
   }
 
-  std::vector<ACClass>::const_iterator
-  end() const {
-    return classes_.end();
+  size_t size() const {
+    return merged_.size();
   }
 
-  ACClass *at(size_t id) {
-    auto canonical = &classes_.at(id);
-    while (!canonical->IsPrimary()) {
-      canonical = &classes_[canonical->merged_with_];
+  //! The canonical class among all merged with @p id
+  ACClass at(size_t id) const {
+    if (id >= size()) {
+      throw std::out_of_range("No class with such id");
     }
-    return canonical;
+    return Snapshot(CanonicalOf(id));
   }
 
-  //! Replace every merged_with_ with the final id
-  /**
-   * Should be called after the modification batch
-   */
-  void Normalize() {
-    for (auto &&c : classes_) {
-      c.merged_with_ = at(c.id_)->id_;
-
-      if (c.id_ % 4 == 3) {
-        auto& original = classes_.at(c.id_ - 3);
-        auto& canonical = classes_.at(original.merged_with_);
-        for (auto i = 1u; i < 4; ++i) {
-          auto& image = classes_.at(original.id_ + i);
-          if (original.merged_with_ == image.merged_with_) {
-            // make sure it is allowed for the canonical
-            canonical.aut_types_.set(i);
-          }
-        }
-      }
-    }
+  //! Check if the class is the canonical representative among all merged ones
+  bool IsPrimary(ClassId id) const {
+    return CanonicalOf(id) == id;
+  }
+
+  //! Total length of a pair may be up to this one
+  static constexpr crag::CWord::size_type kMaxPairLength = 2 * crag::CWord::kMaxLength;
+
+  //! Number of the canonical classes
+  size_t DistinctCount() const {
+    return distinct_count_;
   }
 
-  const ACClass *at(size_t id) const {
-    return static_cast<const ACClass *>(const_cast<ACClasses *>(this)->at(id));
+  //! Number of the canonical classes with the minimal pair of total length @p length
+  size_t CountOfLength(crag::CWord::size_type length) const {
+    return length_counts_.at(length);
   }
 
+  //! The canonical classes with the minimal pair of total length @p length in the order of ids
+  /**
+   * Takes the time proportional to their count
+   */
+  std::vector<ClassId> ClassesOfLength(crag::CWord::size_type length) const;
+
+  //! Simple way to print the state of the class, single-line
+  void DescribeForLog(ClassId id, std::ostream* out) const;
+  void DescribeForLog(ClassId id, fmt::MemoryWriter* out) const;
+
   //! Get the 'canonical' representative for the class
-  const crag::CWordTuple<2> &minimal_in(ClassId id) const {
-    return at(id)->minimal_;
+  ACPair minimal_in(ClassId id) const {
+    return MinimalOf(CanonicalOf(id));
   }
 
   //! Check if automorphisms may be used for this class
@@ -111,11 +161,11 @@ class ACClasses {
    * i.e. there is are 3 pairs of words in this class such that \phi(u, v) ~(ACM) (u, v)
    */
   bool AllowsAutMoves(ClassId id) const {
-    return at(IdentityImageFor(id))->aut_types_.all();
+    return AutTypes(CanonicalOf(IdentityImageFor(id))).all();
   }
 
   bool AreMerged(ClassId first, ClassId second) const {
-    return at(first) == at(second);
+    return CanonicalOf(first) == CanonicalOf(second);
   }
 
   static constexpr bool IsIdent(ClassId id) {
@@ -127,7 +177,7 @@ class ACClasses {
   }
 
   bool AllowsAutomorphism(ClassId id, ACClass::AutKind type) const {
-    return at(id)->aut_types_.test(static_cast<size_t>(type));
+    return AutTypes(CanonicalOf(id)).test(static_cast<size_t>(type));
   }
 
 #ifndef NDEBUG
@@ -135,7 +185,75 @@ class ACClasses {
 #endif
 
  private:
-  std::vector<ACClass> classes_;
+  using Index = uint32_t;
+
+  template <typename T>
+  using Pages = CowPagedVector<T>;
+
+  static constexpr uint64_t kLongKey = 1ull << 63u; //!< Marks the keys which are indices in long_minimals_
+
+  Pages<ACPair> initial_; //!< One per input, i.e. per 4 classes
+  Pages<uint64_t> minimal_; //!< Valid for the canonical classes only
+  Pages<ACPair> long_minimals_;
+  Pages<uint8_t> aut_types_; //!< Valid for the canonical classes only
+  crag::DisjointSets<Index, false, Pages<Index>> merged_; //!< Merged by size, so the paths are short without Flatten()
+  Pages<Index> canonical_; //!< The least id in the subset of a root, which is the canonical class
+  Pages<Index> next_in_subset_; //!< Every subset is a cyclic list, so that the smaller one can be traversed on Merge
+
+  Index Canonical(Index root) const {
+    return canonical_[root];
+  }
+
+  //! Same as Canonical(merged_.Find(id)), but doesn't shorten the paths, so that the published versions can be read
+  Index CanonicalOf(ClassId id) const {
+    return Canonical(merged_.Find(static_cast<Index>(id)));
+  }
+
+  Index NextInSubset(Index id) const {
+    return next_in_subset_[id];
+  }
+
+  std::bitset<4> AutTypes(Index id) const {
+    return aut_types_[id];
+  }
+
+  static constexpr Index kNoClass = ~Index{0};
+
+  size_t distinct_count_ = 0u;
+  std::array<size_t, kMaxPairLength + 1> length_counts_{};
+  std::array<Index, kMaxPairLength + 1> length_heads_; //!< The canonical classes of one length form a list
+  Pages<Index> length_next_;
+  Pages<Index> length_prev_;
+
+  crag::CWord::size_type MinimalLength(Index id) const;
+
+  //! Adds the canonical class @p id to the list and the count of its minimal length
+  void LinkToLength(Index id);
+
+  //! Removes @p id from the statistics, should be called before its minimal pair is changed
+  void UnlinkFromLength(Index id);
+
+  //! Key of @p pair, which is stored in long_minimals_ if it doesn't fit into PackPair()
+  /**
+   * The keys of the long pairs are greater than the packed ones, so the keys of different lengths may be compared
+   * directly, see MinimalKeyLess()
+   */
+  uint64_t MinimalKey(const ACPair& pair);
+
+  //! Changes the minimal pair of @p id, a long one takes the slot in long_minimals_ of the previous one if it was long
+  /**
+   * So a slot is abandoned only when the class is merged into another one or its minimum gets short enough to fit
+   * into a key, and long_minimals_ doesn't grow with every new minimum
+   */
+  void SetMinimal(Index id, const ACPair& pair);
+  ACPair MinimalOf(Index id) const;
+  bool MinimalKeyLess(uint64_t first, uint64_t second) const;
+
+  ACClass Snapshot(ClassId id) const;
+
+  //! Allows the automorphisms of the groups of 4 classes which got into one subset after @p id was merged into it
+  void UpdateAutTypes(Index id);
+
   const Config &config_;
   ACStateDump *logger_;
 };
@@ -172,7 +172,6 @@ void EnumerateAC(path config_path) {
     std::string next_line;
     auto input = config.ifstream(config.pairs_classes_in());
 
-    auto expected_index_size = 0u;
     auto initial_batch = ac_index.NewBatch();
 
     while(std::getline(input, next_line)) {
@@ -184,15 +183,11 @@ void EnumerateAC(path config_path) {
       auto pair = ACStateDump::LoadPair(next_line.substr(0, split));
       auto ac_class = initial_classes_version->at(std::stoul(next_line.substr(split + 1)));
 
-      initial_batch.Push(pair, ac_class->id_);
-      ++expected_index_size;
-      initial_classes_version->AddPair(ac_class->id_, pair);
+      initial_batch.Push(pair, ac_class.id_);
+      initial_classes_version->AddPair(ac_class.id_, pair);
     }
 
-    initial_batch.Execute();
-    while (ac_index.GetData().size() < expected_index_size) {
-      std::this_thread::yield();
-    }
+    ac_index.WaitForCommit(initial_batch.Execute());
   } else {
     initial_classes_version->InitACIndex(&ac_index);
   }
@@ -223,20 +218,13 @@ void EnumerateAC(path config_path) {
     }
   }
 
-  std::map<crag::CWord::size_type, size_t> lengths_counts;
-  auto total_count = 0u;
-  auto distinct_count = 0u;
+  size_t total_count = 0u;
+  size_t distinct_count = 0u;
 
   {
     auto ac_classes = ac_index.GetCurrentACClasses();
-    for (auto &&c : *ac_classes) {
-      ++total_count;
-      if (c.IsPrimary()) {
-        ++distinct_count;
-        const auto &minimal = ac_classes->minimal_in(c.id_);
-        ++lengths_counts[minimal[0].size() + minimal[1].size()];
-      }
-    }
+    total_count = ac_classes->size();
+    distinct_count = ac_classes->DistinctCount();
   }
 
   fmt::print(std::clog, "Loaded {} classes, {} are distinct now\n", total_count, distinct_count);
@@ -244,14 +232,17 @@ void EnumerateAC(path config_path) {
   if (distinct_count < 100) {
     auto ac_classes = ac_index.GetCurrentACClasses();
     for (auto&& c : *ac_classes) {
-      if (c.IsPrimary() || total_count < 100) {
-        c.DescribeForLog(&std::clog);
+      if (ac_classes->IsPrimary(c.id_) || total_count < 100) {
+        ac_classes->DescribeForLog(c.id_, &std::clog);
         std::clog << "\n";
       }
     }
   } else {
-    for (auto&& length : lengths_counts) {
-      fmt::print(std::clog, "Length {}: {}\n", length.first, length.second);
+    auto ac_classes = ac_index.GetCurrentACClasses();
+    for (crag::CWord::size_type length = 0; length <= ACClasses::kMaxPairLength; ++length) {
+      if (ac_classes->CountOfLength(length) != 0) {
+        fmt::print(std::clog, "Length {}: {}\n", length, ac_classes->CountOfLength(length));
+      }
     }
   }
 
@@ -270,14 +261,14 @@ void EnumerateAC(path config_path) {
   std::clog << "Full report:\n";
   auto ac_classes = ac_index.GetCurrentACClasses();
   for (auto&& c : *ac_classes) {
-    c.DescribeForLog(&std::clog);
+    ac_classes->DescribeForLog(c.id_, &std::clog);
     std::clog << "\n";
   }
 
   std::clog << "Primary report:\n";
   for (auto&& c : *ac_classes) {
-    if (c.IsPrimary()) {
-      c.DescribeForLog(&std::clog);
+    if (ac_classes->IsPrimary(c.id_)) {
+      ac_classes->DescribeForLog(c.id_, &std::clog);
       std::clog << "\n";
     }
   }
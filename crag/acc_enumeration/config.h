@@ -167,6 +167,40 @@ struct Config {
 
   size_t workers_count_ = std::thread::hardware_concurrency();
 
+  //! Maximal estimated number of closed walks a single ACM-move may harvest, 0 means no limit
+  size_t harvest_budget_ = 0u;
+
+  //! Run the cheap tests from pair_filters before the ACM-moves
+  bool use_pair_filters_ = true;
+
+  //! Also run ConjugationLengthReduction from pair_filters, which is much more expensive than the other tests
+  bool use_conjugation_length_filter_ = false;
+
+  //! A worker sends its new pairs to the index once it has that many of them...
+  size_t commit_pairs_ = 256u;
+
+  //! ...or once they take that much memory...
+  size_t commit_bytes_ = (1u << 20);
+
+  //! ...or once the oldest of them waits that long
+  size_t commit_window_ms_ = 20u;
+
+  //! The lookups of the pairs which are not in the index are cut by a Bloom filter with this false positive rate...
+  double index_filter_fp_rate_ = 0.01;
+
+  //! ...which takes at most that much memory, 0 disables it
+  size_t index_filter_bytes_ = (1u << 30);
+
+  //! The index is split into that many parts by the hash of a pair, each of them is updated by its own thread
+  size_t index_shards_ = std::max(1u, std::thread::hardware_concurrency() / 4);
+
+  //! How the index is searched
+  enum class IndexLayout {
+    kSorted,      //!< Binary search over the array
+    kStaticBTree, //!< A static B-tree over the array, see StaticSearchTree
+    kHash         //!< The pairs which fit PackPair are kept in a hash table instead, see PairHashTable
+  } index_layout_ = IndexLayout::kStaticBTree;
+
   static constexpr float kFractionNotUsed = -1.0f;
   float workers_count_fraction_ = kFractionNotUsed;
 
@@ -183,7 +217,27 @@ struct Config {
     dump["dump_dir"] = dump_dir_.generic_string();
     dump["dump_memory_limit"] = ToHumanReadableByteCount(memory_limit_);
     dump["dump_queue_limit"] = std::to_string(dump_queue_limit_);
+    dump["harvest_budget"] = std::to_string(harvest_budget_);
+    dump["commit_pairs"] = std::to_string(commit_pairs_);
+    dump["commit_bytes"] = ToHumanReadableByteCount(commit_bytes_);
+    dump["commit_window_ms"] = std::to_string(commit_window_ms_);
+    dump["index_filter_fp_rate"] = fmt::format("{}", index_filter_fp_rate_);
+    dump["index_filter_bytes"] = ToHumanReadableByteCount(index_filter_bytes_);
+    dump["index_shards"] = std::to_string(index_shards_);
+    switch (index_layout_) {
+      case IndexLayout::kSorted:
+        dump["index_layout"] = "sorted";
+        break;
+      case IndexLayout::kStaticBTree:
+        dump["index_layout"] = "btree";
+        break;
+      case IndexLayout::kHash:
+        dump["index_layout"] = "hash";
+        break;
+    }
     dump["input"] = input_.generic_string();
+    dump["pair_filters"] = use_pair_filters_;
+    dump["conjugation_length_filter"] = use_conjugation_length_filter_;
     dump["stats_dir"] = stats_dir_.generic_string();
     dump["should_clear_dumps"] = should_clear_dumps_;
 
@@ -215,6 +269,8 @@ struct Config {
     ConfigFromJson(config, "dump_dir", &dump_dir_);
     ConfigFromJson(config, "stats_dir", &stats_dir_);
     ConfigFromJson(config, "should_clear_dumps", &should_clear_dumps_);
+    ConfigFromJson(config, "pair_filters", &use_pair_filters_);
+    ConfigFromJson(config, "conjugation_length_filter", &use_conjugation_length_filter_);
 
     std::string temp;
     ConfigFromJson(config, "stats_to_stdout", &temp);
@@ -243,6 +299,68 @@ struct Config {
       temp.clear();
     }
 
+    ConfigFromJson(config, "harvest_budget", &temp);
+    if (!temp.empty()) {
+      harvest_budget_ = std::stoul(temp);
+      temp.clear();
+    }
+
+    ConfigFromJson(config, "commit_pairs", &temp);
+    if (!temp.empty()) {
+      commit_pairs_ = std::stoul(temp);
+      temp.clear();
+    }
+
+    ConfigFromJson(config, "commit_bytes", &temp);
+    if (!temp.empty()) {
+      commit_bytes_ = FromHumanReadableByteCount(temp);
+      temp.clear();
+    }
+
+    ConfigFromJson(config, "commit_window_ms", &temp);
+    if (!temp.empty()) {
+      commit_window_ms_ = std::stoul(temp);
+      temp.clear();
+    }
+
+    ConfigFromJson(config, "index_filter_fp_rate", &temp);
+    if (!temp.empty()) {
+      index_filter_fp_rate_ = std::stod(temp);
+      if (index_filter_fp_rate_ <= 0 || index_filter_fp_rate_ >= 1) {
+        throw std::runtime_error("index_filter_fp_rate must be between 0 and 1");
+      }
+      temp.clear();
+    }
+
+    ConfigFromJson(config, "index_filter_bytes", &temp);
+    if (!temp.empty()) {
+      index_filter_bytes_ = FromHumanReadableByteCount(temp);
+      temp.clear();
+    }
+
+    ConfigFromJson(config, "index_shards", &temp);
+    if (!temp.empty()) {
+      index_shards_ = std::stoul(temp);
+      if (index_shards_ == 0) {
+        throw std::runtime_error("index_shards should be positive");
+      }
+      temp.clear();
+    }
+
+    ConfigFromJson(config, "index_layout", &temp);
+    if (!temp.empty()) {
+      if (temp == "sorted") {
+        index_layout_ = IndexLayout::kSorted;
+      } else if (temp == "btree") {
+        index_layout_ = IndexLayout::kStaticBTree;
+      } else if (temp == "hash") {
+        index_layout_ = IndexLayout::kHash;
+      } else {
+        throw std::runtime_error(fmt::format("Unknown index_layout {}, should be sorted, btree or hash", temp));
+      }
+      temp.clear();
+    }
+
     ConfigFromJson(config, "workers_count", &temp);
     if (!temp.empty()) {
       if (temp.find('.') != std::string::npos) {
@@ -0,0 +1,188 @@
+#ifndef ACC_COW_PAGED_VECTOR_H
+#define ACC_COW_PAGED_VECTOR_H
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+//! Vector split into pages of a fixed size, which are shared between the copies
+/**
+ * A copy takes the time proportional to the number of pages, and a page is copied only when it is modified through
+ * a vector which doesn't own it. Only the pages created with the current owner token of a vector are modified in place,
+ * and a copy renews the tokens of both vectors. So a version which was copied and published to other threads is never
+ * changed, while only its writer has to care about that.
+ *
+ * Any non-const access is considered a modification, so the reads should go through a const reference.
+ */
+template <typename T, size_t kPageSize = 1024>
+class CowPagedVector {
+  struct Page {
+    uint64_t owner_;
+    std::vector<T> items_;
+  };
+
+ public:
+  using value_type = T;
+
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = ptrdiff_t;
+    using pointer = const T*;
+    using reference = const T&;
+
+    const_iterator(const CowPagedVector* container, size_t index)
+        : container_(container)
+        , index_(index)
+    { }
+
+    reference operator*() const {
+      return (*container_)[index_];
+    }
+
+    pointer operator->() const {
+      return &(*container_)[index_];
+    }
+
+    const_iterator& operator++() {
+      ++index_;
+      return *this;
+    }
+
+    bool operator==(const const_iterator& other) const {
+      return index_ == other.index_;
+    }
+
+    bool operator!=(const const_iterator& other) const {
+      return index_ != other.index_;
+    }
+
+   private:
+    const CowPagedVector* container_;
+    size_t index_;
+  };
+
+  CowPagedVector()
+      : owner_(NewOwner())
+  { }
+
+  CowPagedVector(const CowPagedVector& other)
+      : pages_(other.pages_)
+      , size_(other.size_)
+      , owner_(NewOwner())
+  {
+    other.owner_.store(NewOwner(), std::memory_order_relaxed);
+  }
+
+  CowPagedVector& operator=(const CowPagedVector& other) {
+    if (this != &other) {
+      pages_ = other.pages_;
+      size_ = other.size_;
+      owner_.store(NewOwner(), std::memory_order_relaxed);
+      other.owner_.store(NewOwner(), std::memory_order_relaxed);
+    }
+    return *this;
+  }
+
+  CowPagedVector(CowPagedVector&& other)
+      : pages_(std::move(other.pages_))
+      , size_(other.size_)
+      , owner_(other.owner_.load(std::memory_order_relaxed))
+  {
+    other.pages_.clear();
+    other.size_ = 0;
+  }
+
+  CowPagedVector& operator=(CowPagedVector&& other) {
+    pages_ = std::move(other.pages_);
+    size_ = other.size_;
+    owner_.store(other.owner_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    other.pages_.clear();
+    other.size_ = 0;
+    return *this;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  const T& operator[](size_t i) const {
+    assert(i < size_);
+    return pages_[i / kPageSize]->items_[i % kPageSize];
+  }
+
+  //! Copies the page of @p i if it is shared with some other copy
+  T& operator[](size_t i) {
+    assert(i < size_);
+    return MutablePage(i / kPageSize).items_[i % kPageSize];
+  }
+
+  template <typename... Args>
+  void emplace_back(Args&&... args) {
+    if (size_ % kPageSize == 0) {
+      pages_.push_back(NewPage());
+    }
+    MutablePage(pages_.size() - 1).items_.emplace_back(std::forward<Args>(args)...);
+    ++size_;
+  }
+
+  void push_back(const T& value) {
+    emplace_back(value);
+  }
+
+  //! Only the growth is supported
+  void resize(size_t count, const T& value = T()) {
+    assert(count >= size_);
+    while (size_ < count) {
+      push_back(value);
+    }
+  }
+
+  void reserve(size_t count) {
+    pages_.reserve((count + kPageSize - 1) / kPageSize);
+  }
+
+  const_iterator begin() const {
+    return const_iterator(this, 0);
+  }
+
+  const_iterator end() const {
+    return const_iterator(this, size_);
+  }
+
+ private:
+  std::vector<std::shared_ptr<Page>> pages_;
+  size_t size_ = 0;
+  mutable std::atomic<uint64_t> owner_; //!< Changed by the copies, so that the source doesn't own the shared pages
+
+  static uint64_t NewOwner() {
+    static std::atomic<uint64_t> next_owner{0};
+    return next_owner.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  std::shared_ptr<Page> NewPage() const {
+    auto page = std::make_shared<Page>();
+    page->owner_ = owner_.load(std::memory_order_relaxed);
+    page->items_.reserve(kPageSize);
+    return page;
+  }
+
+  Page& MutablePage(size_t page) {
+    if (pages_[page]->owner_ != owner_.load(std::memory_order_relaxed)) {
+      auto copy = NewPage();
+      copy->items_ = pages_[page]->items_;
+      pages_[page] = std::move(copy);
+    }
+    return *pages_[page];
+  }
+};
+
+#endif //ACC_COW_PAGED_VECTOR_H
@@ -0,0 +1,146 @@
+#ifndef ACC_INDEX_SEARCH_H
+#define ACC_INDEX_SEARCH_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//! Searches over the sorted arrays of the index, which are too large for the caches
+
+inline void PrefetchItem(const void *item) {
+#if defined(__GNUC__)
+  __builtin_prefetch(item);
+#endif
+}
+
+//! Same as std::lower_bound, but prefetches both halves of the next step
+template <typename Item, typename Value, typename Less>
+const Item *PrefetchingLowerBound(const Item *from, const Item *to, const Value &value, Less less) {
+  auto count = static_cast<size_t>(to - from);
+  while (count > 0) {
+    auto half = count / 2;
+    PrefetchItem(from + half / 2);
+    PrefetchItem(from + half + 1 + (count - half - 1) / 2);
+    if (less(from[half], value)) {
+      from += half + 1;
+      count -= half + 1;
+    } else {
+      count = half;
+    }
+  }
+  return from;
+}
+
+//! The first item in [@p from, @p to) which is not less than @p value, searching from @p from outwards
+/**
+ * Makes exponentially growing steps until it passes the value, and the next probe is prefetched while the current
+ * one is compared. So a search which is close to @p from costs only a few probes.
+ */
+template <typename Item, typename Value, typename Less>
+const Item *GallopingLowerBound(const Item *from, const Item *to, const Value &value, Less less) {
+  size_t step = 1;
+  while (step < static_cast<size_t>(to - from)) {
+    auto probe = from + step;
+    if (3 * step + 1 < static_cast<size_t>(to - from)) {
+      PrefetchItem(probe + 1 + 2 * step);
+    }
+    if (!less(*probe, value)) {
+      return PrefetchingLowerBound(from, probe + 1, value, less);
+    }
+    from = probe + 1;
+    step *= 2;
+  }
+  return PrefetchingLowerBound(from, to, value, less);
+}
+
+//! Static B-tree over a sorted array of items, the array itself is its last level
+/**
+ * The array is split into blocks of kFanout items. The first level keeps the key of the first item of every block,
+ * and every next one keeps every kFanout-th key of the previous one, until a level fits into a single node. So
+ * a search reads a node of kFanout keys per level and then a single block of the array, instead of a cache miss
+ * on almost every step of a binary search. The tree takes a little more than 8 bytes per kFanout items.
+ *
+ * The keys are 64-bit and should keep the order of the items: a < b implies key(a) <= key(b). The items with equal
+ * keys are told apart by the search in the array.
+ */
+class StaticSearchTree {
+ public:
+  static constexpr size_t kFanout = 16u;
+
+  StaticSearchTree() = default;
+
+  template <typename Item, typename KeyOf>
+  StaticSearchTree(const std::vector<Item>& items, KeyOf&& key_of) {
+    std::vector<uint64_t> level;
+    level.reserve((items.size() + kFanout - 1) / kFanout);
+    for (size_t i = 0; i < items.size(); i += kFanout) {
+      level.push_back(key_of(items[i]));
+    }
+    while (!level.empty()) {
+      auto upper_level = Every(kFanout, level);
+      levels_.push_back(std::move(level));
+      if (levels_.back().size() <= kFanout) {
+        break;
+      }
+      level = std::move(upper_level);
+    }
+    std::reverse(levels_.begin(), levels_.end());
+  }
+
+  bool empty() const {
+    return levels_.empty();
+  }
+
+  size_t BytesCount() const {
+    size_t bytes = 0;
+    for (auto&& level : levels_) {
+      bytes += level.size() * sizeof(uint64_t);
+    }
+    return bytes;
+  }
+
+  //! Same as std::lower_bound over the array [@p items, @p items_end) the tree was built for
+  template <typename Item, typename Value, typename Less>
+  const Item *LowerBound(const Item *items, const Item *items_end, uint64_t key, const Value &value, Less less) const {
+    auto from = items + Block(key) * kFanout;
+    auto to = std::min(from + kFanout, items_end);
+    auto pos = PrefetchingLowerBound(from, to, value, less);
+    if (pos != to || to == items_end || !less(*to, value)) {
+      return pos;
+    }
+    // only if the next blocks start with the same key
+    return PrefetchingLowerBound(to, items_end, value, less);
+  }
+
+ private:
+  std::vector<std::vector<uint64_t>> levels_; //!< From the root down to the first keys of the blocks
+
+  static std::vector<uint64_t> Every(size_t step, const std::vector<uint64_t>& keys) {
+    std::vector<uint64_t> result;
+    result.reserve((keys.size() + step - 1) / step);
+    for (size_t i = 0; i < keys.size(); i += step) {
+      result.push_back(keys[i]);
+    }
+    return result;
+  }
+
+  //! The last block which starts with a key less than @p key, or the first one if there is none
+  size_t Block(uint64_t key) const {
+    size_t node = 0;
+    for (auto&& level : levels_) {
+      // the first key of the node is less than key, unless it is the very first one, and the first key of the next
+      // node is not, so the block is among the ones of this node
+      auto from = node * kFanout;
+      auto to = std::min(from + kFanout, level.size());
+      size_t less = 0;
+      for (auto i = from; i < to; ++i) {
+        less += level[i] < key;
+      }
+      node = from + (less == 0 ? 0 : less - 1);
+    }
+    return node;
+  }
+};
+
+#endif //ACC_INDEX_SEARCH_H
@@ -0,0 +1,115 @@
+#ifndef ACC_PAIR_BLOOM_FILTER_H
+#define ACC_PAIR_BLOOM_FILTER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "acc_class.h"
+
+//! 64-bit key of any pair, the packed one if it fits and a hash of both words otherwise
+inline uint64_t PairFilterKey(const ACPair& p) {
+  if (FitsPairKey(p)) {
+    return PackPair(p);
+  }
+  auto first = p[0].GetDump();
+  auto second = p[1].GetDump();
+  auto key = (static_cast<uint64_t>(first.length) << 32u) | second.length;
+  key = key * 0x9E3779B97F4A7C15ull ^ first.letters;
+  key = key * 0x9E3779B97F4A7C15ull ^ second.letters;
+  // the packed keys start with the total length, which is at most 26, so their top bit is never set
+  return key | (1ull << 63u);
+}
+
+//! Blocked Bloom filter over 64-bit keys, one may insert and check the keys from different threads at once
+/**
+ * Every key sets its bits in a single block of 512 bits, so a check touches one cache line. The filter never has
+ * false negatives for the keys which were inserted before it was published to the reader.
+ */
+class PairBloomFilter {
+ public:
+  static constexpr size_t kBlockBits = 512u;
+  static constexpr size_t kBlockWords = kBlockBits / 64u;
+
+  //! A filter for @p capacity keys with false positive rate @p fp_rate, but not larger than @p max_bytes
+  /**
+   * If the memory is not enough, the filter keeps working with a higher false positive rate
+   */
+  PairBloomFilter(size_t capacity, double fp_rate, size_t max_bytes)
+      : hashes_count_(HashesCount(fp_rate))
+  {
+    auto bytes = std::min(max_bytes, static_cast<size_t>(std::ceil(capacity * BitsPerKey(fp_rate) / 8)));
+    blocks_count_ = std::max<size_t>(1u, bytes / (kBlockBits / 8));
+    capacity_ = static_cast<size_t>(blocks_count_ * kBlockBits / BitsPerKey(fp_rate));
+    // one more block to align the blocks to the cache lines
+    storage_.reset(new std::atomic<uint64_t>[(blocks_count_ + 1) * kBlockWords]());
+    auto address = reinterpret_cast<uintptr_t>(storage_.get());
+    words_ = storage_.get() + ((kBlockBits / 8 - address % (kBlockBits / 8)) % (kBlockBits / 8)) / 8;
+  }
+
+  //! The number of keys the filter keeps the requested false positive rate for
+  size_t capacity() const {
+    return capacity_;
+  }
+
+  size_t BytesCount() const {
+    return blocks_count_ * kBlockBits / 8;
+  }
+
+  void Insert(uint64_t key) {
+    key = MixPairKey(key);
+    auto block = words_ + Block(key) * kBlockWords;
+    ForEachBit(key, [block](size_t bit) {
+      block[bit / 64].fetch_or(1ull << (bit % 64), std::memory_order_relaxed);
+      return true;
+    });
+  }
+
+  bool MayContain(uint64_t key) const {
+    key = MixPairKey(key);
+    auto block = words_ + Block(key) * kBlockWords;
+    return ForEachBit(key, [block](size_t bit) {
+      return (block[bit / 64].load(std::memory_order_relaxed) & (1ull << (bit % 64))) != 0;
+    });
+  }
+
+ private:
+  size_t hashes_count_;
+  size_t blocks_count_;
+  size_t capacity_;
+  std::unique_ptr<std::atomic<uint64_t>[]> storage_;
+  std::atomic<uint64_t>* words_;
+
+  static double BitsPerKey(double fp_rate) {
+    // the optimal one for a classic filter, a blocked one gets a slightly higher rate with it
+    return -std::log(fp_rate) / (std::log(2.0) * std::log(2.0));
+  }
+
+  static size_t HashesCount(double fp_rate) {
+    return std::max<size_t>(1u, static_cast<size_t>(std::lround(-std::log2(fp_rate))));
+  }
+
+  size_t Block(uint64_t hash) const {
+    return static_cast<size_t>(((hash >> 32u) * blocks_count_) >> 32u);
+  }
+
+  //! Calls @p f for the bits of @p hash in its block until it returns false
+  template <typename F>
+  bool ForEachBit(uint64_t hash, F&& f) const {
+    // double hashing over the lower half of the hash, the step is odd so that the bits are distinct
+    auto bit = static_cast<size_t>(hash % kBlockBits);
+    auto step = static_cast<size_t>((hash >> 9u) % kBlockBits) | 1u;
+    for (size_t i = 0; i < hashes_count_; ++i) {
+      if (!f(bit)) {
+        return false;
+      }
+      bit = (bit + step) % kBlockBits;
+    }
+    return true;
+  }
+};
+
+#endif //ACC_PAIR_BLOOM_FILTER_H
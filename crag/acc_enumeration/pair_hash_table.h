@@ -0,0 +1,184 @@
+#ifndef ACC_PAIR_HASH_TABLE_H
+#define ACC_PAIR_HASH_TABLE_H
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+
+#include <boost/optional.hpp>
+
+#include "acc_class.h"
+
+//! Insert-only hash table from the packed pairs to their classes, with open addressing and linear probing
+/**
+ * The writers claim the slots with a CAS on the key, then store the value, so they may insert from different threads
+ * at once. The readers don't take any locks, they search in a View of the slots, and a key with no value yet
+ * is considered not inserted.
+ *
+ * Once the table gets half full, it is moved to twice as many slots. The move takes the resize lock exclusively,
+ * while the inserts take it shared, so the readers keep searching in their views meanwhile, and the old slots
+ * are freed with the last view of them.
+ */
+class PairHashTable {
+  static constexpr uint64_t kEmpty = ~0ull; //!< Not a packed pair, which has length at most 26 in the top bits
+  static constexpr uint64_t kNoValue = ~0ull;
+
+  struct Slot {
+    std::atomic<uint64_t> key_;
+    std::atomic<uint64_t> value_;
+  };
+
+  struct Slots {
+    explicit Slots(size_t count)
+        : mask_(count - 1)
+        , slots_(new Slot[count])
+    {
+      assert((count & mask_) == 0);
+      for (size_t i = 0; i < count; ++i) {
+        slots_[i].key_.store(kEmpty, std::memory_order_relaxed);
+        slots_[i].value_.store(kNoValue, std::memory_order_relaxed);
+      }
+    }
+
+    size_t size() const {
+      return mask_ + 1;
+    }
+
+    size_t mask_;
+    std::unique_ptr<Slot[]> slots_;
+  };
+
+ public:
+  explicit PairHashTable(size_t initial_slots = (1u << 16))
+      : slots_(std::make_shared<Slots>(initial_slots))
+  { }
+
+  //! The slots at some moment, the inserts which are finished before it was taken are visible through it
+  class View {
+   public:
+    boost::optional<uint64_t> Find(uint64_t key) const {
+      for (auto slot = MixPairKey(key) & slots_->mask_; ; slot = (slot + 1) & slots_->mask_) {
+        auto slot_key = slots_->slots_[slot].key_.load(std::memory_order_acquire);
+        if (slot_key == key) {
+          auto value = slots_->slots_[slot].value_.load(std::memory_order_acquire);
+          if (value == kNoValue) {
+            return boost::none;
+          }
+          return value;
+        }
+        if (slot_key == kEmpty) {
+          return boost::none;
+        }
+      }
+    }
+
+    explicit View(std::shared_ptr<const Slots> slots)
+        : slots_(std::move(slots)) {}
+
+   private:
+    std::shared_ptr<const Slots> slots_;
+  };
+
+  View GetView() const {
+    return View(std::atomic_load_explicit(&slots_, std::memory_order_acquire));
+  }
+
+  //! The number of inserted keys
+  size_t size() const {
+    return size_.load(std::memory_order_acquire);
+  }
+
+  size_t BytesCount() const {
+    return std::atomic_load_explicit(&slots_, std::memory_order_acquire)->size() * sizeof(Slot);
+  }
+
+  //! Inserts the pairs (key, value) of [@p first, @p last) which are not in the table yet
+  /**
+   * For the keys which are already there @p on_existing(item, value) is called. A key should not be inserted from
+   * two threads at once.
+   */
+  template <typename Iterator, typename KeyOf, typename ValueOf, typename OnExisting>
+  void Insert(Iterator first, Iterator last, KeyOf&& key_of, ValueOf&& value_of, OnExisting&& on_existing) {
+    auto count = static_cast<size_t>(std::distance(first, last));
+    Reserve(count);
+
+    size_t inserted = 0;
+    {
+      std::shared_lock<std::shared_timed_mutex> lock(resize_mutex_);
+      auto& slots = *slots_;
+      for (; first != last; ++first) {
+        auto value = static_cast<uint64_t>(value_of(*first));
+        assert(value != kNoValue);
+        auto existing = Insert(&slots, key_of(*first), value);
+        if (existing == kNoValue) {
+          ++inserted;
+        } else {
+          on_existing(*first, existing);
+        }
+      }
+    }
+
+    size_.fetch_add(inserted, std::memory_order_acq_rel);
+    reserved_.fetch_sub(count - inserted, std::memory_order_relaxed);
+  }
+
+ private:
+  std::shared_ptr<Slots> slots_; // shared with the views, replaced only under the exclusive resize lock
+  std::shared_timed_mutex resize_mutex_;
+  std::atomic<size_t> size_{0u};
+  std::atomic<size_t> reserved_{0u}; //!< The size plus the keys which are being inserted, an upper bound of the size
+
+  //! Returns kNoValue if inserted, and the value of @p key otherwise
+  static uint64_t Insert(Slots* slots, uint64_t key, uint64_t value) {
+    assert(key != kEmpty);
+    for (auto slot = MixPairKey(key) & slots->mask_; ; slot = (slot + 1) & slots->mask_) {
+      auto& current = slots->slots_[slot];
+      auto slot_key = current.key_.load(std::memory_order_acquire);
+      if (slot_key == kEmpty) {
+        if (current.key_.compare_exchange_strong(slot_key, key, std::memory_order_acq_rel)) {
+          current.value_.store(value, std::memory_order_release);
+          return kNoValue;
+        }
+        // someone else has claimed the slot, slot_key is the new key
+      }
+      if (slot_key == key) {
+        return current.value_.load(std::memory_order_acquire);
+      }
+    }
+  }
+
+  //! Moves the table to more slots if @p count more keys would make it more than half full
+  void Reserve(size_t count) {
+    auto reserved = reserved_.fetch_add(count, std::memory_order_relaxed) + count;
+    if (2 * reserved <= std::atomic_load_explicit(&slots_, std::memory_order_acquire)->size()) {
+      return;
+    }
+
+    std::unique_lock<std::shared_timed_mutex> lock(resize_mutex_);
+    reserved = reserved_.load(std::memory_order_relaxed);
+    auto new_size = slots_->size();
+    while (2 * reserved > new_size) {
+      new_size *= 2;
+    }
+    if (new_size == slots_->size()) {
+      // someone else has already done it
+      return;
+    }
+
+    auto new_slots = std::make_shared<Slots>(new_size);
+    for (size_t slot = 0; slot < slots_->size(); ++slot) {
+      auto key = slots_->slots_[slot].key_.load(std::memory_order_relaxed);
+      if (key != kEmpty) {
+        Insert(new_slots.get(), key, slots_->slots_[slot].value_.load(std::memory_order_relaxed));
+      }
+    }
+    std::atomic_store_explicit(&slots_, std::move(new_slots), std::memory_order_release);
+  }
+};
+
+#endif //ACC_PAIR_HASH_TABLE_H
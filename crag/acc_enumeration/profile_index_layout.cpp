@@ -0,0 +1,137 @@
+//! Compares the lookup throughput of the index layouts on random pairs
+/**
+ * Usage: profile_index_layout [millions of pairs...], 10, 100 and 500 millions by default. A pair takes 40 bytes,
+ * so the larger sizes need the memory of the real runs.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "acc_class.h"
+#include "index_search.h"
+#include "random_pairs.h"
+
+using namespace crag;
+
+namespace {
+
+using Item = std::pair<ACPair, size_t>;
+using Clock = std::chrono::steady_clock;
+
+bool KeyLessVal(const Item& lhs, const ACPair& rhs) {
+  return lhs.first < rhs;
+}
+
+template <typename Search>
+void Measure(const char* name, const std::vector<ACPair>& queries, const std::vector<const Item*>& expected,
+             Search&& search) {
+  auto start = Clock::now();
+  size_t mismatches = 0;
+  search([&](size_t query, const Item* pos) {
+    mismatches += pos != expected[query];
+  });
+  auto time = std::chrono::duration<double>(Clock::now() - start).count();
+  fmt::print("  {:<24} {:8.2f} M lookups/s", name, queries.size() / time / 1e6);
+  if (mismatches != 0) {
+    fmt::print(", {} WRONG RESULTS", mismatches);
+  }
+  fmt::print("\n");
+}
+
+void Profile(size_t count) {
+  fmt::print("{}M pairs, {:.1f}GB\n", count / 1000000, count * sizeof(Item) / 1e9);
+  std::mt19937_64 generator;
+
+  std::vector<Item> items;
+  items.reserve(count);
+  while (items.size() < count) {
+    items.emplace_back(RandomIndexPair(generator), items.size());
+  }
+  std::sort(items.begin(), items.end());
+  items.erase(std::unique(items.begin(), items.end(), [](const Item& lhs, const Item& rhs) {
+    return lhs.first == rhs.first;
+  }), items.end());
+
+  auto build_start = Clock::now();
+  StaticSearchTree tree(items, [](const Item& item) { return PairOrderKey(item.first); });
+  fmt::print("  static B-tree: {:.1f}MB, built in {:.3f}s\n", tree.BytesCount() / 1e6,
+             std::chrono::duration<double>(Clock::now() - build_start).count());
+
+  // half of the lookups are misses, as for the harvested pairs
+  const size_t kQueries = 1u << 21;
+  std::vector<ACPair> queries;
+  queries.reserve(kQueries);
+  std::uniform_int_distribution<size_t> item(0, items.size() - 1);
+  while (queries.size() < kQueries) {
+    queries.push_back(queries.size() % 2 ? items[item(generator)].first : RandomIndexPair(generator));
+  }
+
+  const auto *begin = items.data();
+  const auto *end = begin + items.size();
+  std::vector<const Item*> expected;
+  expected.reserve(kQueries);
+  for (auto&& query : queries) {
+    expected.push_back(std::lower_bound(begin, end, query, KeyLessVal));
+  }
+
+  Measure("std::lower_bound", queries, expected, [&](auto&& check) {
+    for (size_t i = 0; i < queries.size(); ++i) {
+      check(i, std::lower_bound(begin, end, queries[i], KeyLessVal));
+    }
+  });
+  Measure("prefetching", queries, expected, [&](auto&& check) {
+    for (size_t i = 0; i < queries.size(); ++i) {
+      check(i, PrefetchingLowerBound(begin, end, queries[i], KeyLessVal));
+    }
+  });
+  Measure("static B-tree", queries, expected, [&](auto&& check) {
+    for (size_t i = 0; i < queries.size(); ++i) {
+      check(i, tree.LowerBound(begin, end, PairOrderKey(queries[i]), queries[i], KeyLessVal));
+    }
+  });
+
+  // sorted batches, as FindSorted gets them from ACMMove
+  const size_t kBatch = 1024u;
+  for (size_t batch = 0; batch < queries.size(); batch += kBatch) {
+    std::sort(queries.begin() + batch, queries.begin() + batch + kBatch);
+  }
+  for (size_t i = 0; i < queries.size(); ++i) {
+    expected[i] = std::lower_bound(begin, end, queries[i], KeyLessVal);
+  }
+
+  Measure("batches, galloping", queries, expected, [&](auto&& check) {
+    for (size_t batch = 0; batch < queries.size(); batch += kBatch) {
+      const auto *position = begin;
+      for (auto i = batch; i < batch + kBatch; ++i) {
+        position = GallopingLowerBound(position, end, queries[i], KeyLessVal);
+        check(i, position);
+      }
+    }
+  });
+  Measure("batches, static B-tree", queries, expected, [&](auto&& check) {
+    for (size_t i = 0; i < queries.size(); ++i) {
+      check(i, tree.LowerBound(begin, end, PairOrderKey(queries[i]), queries[i], KeyLessVal));
+    }
+  });
+}
+
+} //namespace
+
+int main(int argc, char* argv[]) {
+  std::vector<size_t> millions = {10, 100, 500};
+  if (argc > 1) {
+    millions.clear();
+    for (auto arg = 1; arg < argc; ++arg) {
+      millions.push_back(std::stoul(argv[arg]));
+    }
+  }
+  for (auto count : millions) {
+    Profile(count * 1000000);
+  }
+  return 0;
+}
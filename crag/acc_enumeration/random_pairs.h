@@ -0,0 +1,35 @@
+#ifndef ACC_RANDOM_PAIRS_H
+#define ACC_RANDOM_PAIRS_H
+
+#include <algorithm>
+#include <random>
+
+#include "acc_class.h"
+
+//! Random pairs for the tests and the profilers of the index
+
+//! A reduced word of exactly @p length letters
+template <typename RandomEngine>
+crag::CWord RandomReducedWord(RandomEngine& engine, crag::CWord::size_type length) {
+  // every letter changes the length by one, so crag::RandomWord stops exactly at the length
+  return crag::RandomWord(length, length)(engine);
+}
+
+//! A pair of reduced words of total length @p length, each of them has at least @p min_word_length letters
+template <typename RandomEngine>
+ACPair RandomPair(RandomEngine& engine, crag::CWord::size_type length, crag::CWord::size_type min_word_length = 0) {
+  using crag::CWord;
+  auto first_length = std::uniform_int_distribution<CWord::size_type>(
+      std::max<CWord::size_type>(min_word_length, length > CWord::kMaxLength ? length - CWord::kMaxLength : 0u),
+      std::min<CWord::size_type>(length - min_word_length, CWord::size_type{CWord::kMaxLength}))(engine);
+  return ACPair{RandomReducedWord(engine, first_length),
+                RandomReducedWord(engine, static_cast<CWord::size_type>(length - first_length))};
+}
+
+//! Pairs of the lengths the enumeration deals with, from 13 to 40, so some of them are too long for PackPair
+template <typename RandomEngine>
+ACPair RandomIndexPair(RandomEngine& engine) {
+  return RandomPair(engine, std::uniform_int_distribution<crag::CWord::size_type>(13, 40)(engine), 1);
+}
+
+#endif //ACC_RANDOM_PAIRS_H
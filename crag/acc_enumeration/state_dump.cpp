@@ -53,15 +53,15 @@ ACStateDump::~ACStateDump() {
   writer_.join();
 }
 
-void ACStateDump::Merge(const ACClass& a, const ACClass& b) {
+void ACStateDump::Merge(size_t first_id, size_t second_id) {
   Write(classes_merges_out_, [&](fmt::MemoryWriter& data) {
-    data.write("{} {}\n", a.id_, b.id_);
+    data.write("{} {}\n", first_id, second_id);
   });
 }
 
-void ACStateDump::NewMinimum(const ACClass& c, const ACPair& p) {
+void ACStateDump::NewMinimum(size_t id, const ACPair& p) {
   Write(classes_minimums_out_, [&](fmt::MemoryWriter& data) {
-    data.write("{} {} {}\n", c.id_, ToString(p[0]), ToString(p[1]));
+    data.write("{} {} {}\n", id, ToString(p[0]), ToString(p[1]));
   });
 }
 
@@ -172,10 +172,10 @@ void ACStateDump::DumpPairQueueState(const ACPair& pair, PairQueueState state) {
   });
 }
 
-void ACStateDump::DumpPairClass(const ACPair& p, const ACClass& c) {
+void ACStateDump::DumpPairClass(const ACPair& p, size_t id) {
   Write(ac_pair_class_, [&](fmt::MemoryWriter& data) {
     DumpPair(p, &data);
-    data.write(" {}\n", c.id_);
+    data.write(" {}\n", id);
   });
 }
 
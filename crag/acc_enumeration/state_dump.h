@@ -8,6 +8,7 @@
 #include <thread>
 #include "acc_class.h"
 #include "boost_filtering_stream.h"
+#include "config.h"
 #include <crag/multithreading/SharedQueue.h>
 
 struct ACStateDump {
@@ -25,7 +26,7 @@ struct ACStateDump {
   ACStateDump& operator=(ACStateDump&&)=default;
   ~ACStateDump();
 
-  void Merge(const ACClass&, const ACClass&);
+  void Merge(size_t first_id, size_t second_id);
 
   static void DumpPair(const ACPair& p, std::ostream* out);
   static void DumpPair(const ACPair& p, fmt::MemoryWriter* out);
@@ -34,7 +35,7 @@ struct ACStateDump {
 
   static ACPair LoadPair(const std::string& pair_dump);
 
-  void NewMinimum(const ACClass&, const ACPair&);
+  void NewMinimum(size_t id, const ACPair&);
   void DumpVertexHarvest(const ACPair& v, unsigned int harvest_limit, unsigned int complete_count);
 
   void DumpHarvestEdge(const ACPair& from, const ACPair& to, bool from_is_flipped);
@@ -43,7 +44,7 @@ struct ACStateDump {
 
   template<typename Container>
   void DumpAutomorphEdges(const ACPair& from, const Container& to, bool inverse);
-  void DumpPairClass(const ACPair& p, const ACClass& c);
+  void DumpPairClass(const ACPair& p, size_t id);
 
   enum class PairQueueState : size_t {
     Pushed = (1 << 0),
@@ -0,0 +1,79 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "acc_class.h"
+#include "random_pairs.h"
+
+using namespace crag;
+
+namespace {
+
+std::vector<ACPair> RandomPairs(CWord::size_type min_length, CWord::size_type max_length) {
+  std::mt19937_64 engine(17);
+  std::vector<ACPair> pairs;
+  for (auto length = min_length; length <= max_length; ++length) {
+    for (auto repeat = 0u; repeat < 300u; ++repeat) {
+      pairs.push_back(RandomPair(engine, length));
+    }
+  }
+  return pairs;
+}
+
+TEST(PackPair, Boundary) {
+  EXPECT_TRUE(FitsPairKey(ACPair{CWord("xyxyxyxyxyxyx"), CWord("YXYXYXYXYXYXY")}));
+  EXPECT_FALSE(FitsPairKey(ACPair{CWord("xyxyxyxyxyxyx"), CWord("YXYXYXYXYXYXYx")}));
+  EXPECT_TRUE(FitsPairKey(ACPair{CWord(), CWord("yyyyyyyyyyyyyyyyyyyyyyyyyy")}));
+  EXPECT_FALSE(FitsPairKey(ACPair{CWord("yyyyyyyyyyyyyyyyyyyyyyyyyyy"), CWord()}));
+}
+
+TEST(PackPair, RoundTrip) {
+  for (auto&& pair : RandomPairs(0, kMaxPackedPairLength)) {
+    ASSERT_EQ(pair, UnpackPair(PackPair(pair))) << pair;
+  }
+
+  // all letters set
+  ACPair longest{CWord("YYYYYYYYYYYYY"), CWord("YYYYYYYYYYYYY")};
+  EXPECT_EQ(longest, UnpackPair(PackPair(longest)));
+  ACPair single{CWord("yyyyyyyyyyyyyyyyyyyyyyyyyy"), CWord()};
+  EXPECT_EQ(single, UnpackPair(PackPair(single)));
+}
+
+TEST(PackPair, KeepsOrder) {
+  auto pairs = RandomPairs(0, kMaxPackedPairLength);
+  std::sort(pairs.begin(), pairs.end());
+  for (size_t i = 1; i < pairs.size(); ++i) {
+    if (pairs[i - 1] == pairs[i]) {
+      ASSERT_EQ(PackPair(pairs[i - 1]), PackPair(pairs[i]));
+    } else {
+      ASSERT_LT(PackPair(pairs[i - 1]), PackPair(pairs[i])) << pairs[i - 1] << " " << pairs[i];
+    }
+  }
+}
+
+TEST(PairOrderKey, KeepsOrder) {
+  auto pairs = RandomPairs(0, 2 * CWord::kMaxLength);
+  std::sort(pairs.begin(), pairs.end());
+  for (size_t i = 1; i < pairs.size(); ++i) {
+    auto previous = PairOrderKey(pairs[i - 1]);
+    auto current = PairOrderKey(pairs[i]);
+    ASSERT_LE(previous, current) << pairs[i - 1] << " " << pairs[i];
+    if (previous == current && pairs[i - 1] != pairs[i]) {
+      // only the long pairs may share a key
+      ASSERT_FALSE(FitsPairKey(pairs[i])) << pairs[i];
+    }
+  }
+
+  for (auto&& pair : RandomPairs(0, kMaxPackedPairLength)) {
+    ASSERT_EQ(PackPair(pair), PairOrderKey(pair));
+  }
+
+  // the longest packed pair goes before the shortest long one
+  ACPair longest_packed{CWord("YYYYYYYYYYYYY"), CWord("YYYYYYYYYYYYY")};
+  ACPair shortest_long{CWord(), CWord("xxxxxxxxxxxxxxxxxxxxxxxxxxx")};
+  EXPECT_LT(PairOrderKey(longest_packed), PairOrderKey(shortest_long));
+}
+
+} //namespace
@@ -0,0 +1,137 @@
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "cow_paged_vector.h"
+
+namespace {
+
+using Vector = CowPagedVector<int, 4>;
+
+Vector Iota(int count) {
+  Vector v;
+  for (int i = 0; i < count; ++i) {
+    v.push_back(i);
+  }
+  return v;
+}
+
+const int& ConstAt(const Vector& v, size_t i) {
+  return v[i];
+}
+
+TEST(CowPagedVector, PushAndRead) {
+  auto v = Iota(10);
+  ASSERT_EQ(10u, v.size());
+  EXPECT_FALSE(v.empty());
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(i, ConstAt(v, i));
+  }
+
+  v.resize(13, -1);
+  ASSERT_EQ(13u, v.size());
+  EXPECT_EQ(9, ConstAt(v, 9));
+  EXPECT_EQ(-1, ConstAt(v, 12));
+
+  int expected = 0;
+  for (auto&& item : v) {
+    if (expected < 10) {
+      EXPECT_EQ(expected, item);
+    }
+    ++expected;
+  }
+  EXPECT_EQ(13, expected);
+
+  EXPECT_TRUE(Vector().empty());
+}
+
+TEST(CowPagedVector, CopyIsIsolated) {
+  auto original = Iota(10);
+  auto copy = original;
+
+  original[1] = 100;
+  original.push_back(10);
+  copy[9] = 200;
+
+  EXPECT_EQ(11u, original.size());
+  EXPECT_EQ(100, ConstAt(original, 1));
+  EXPECT_EQ(9, ConstAt(original, 9));
+  EXPECT_EQ(10, ConstAt(original, 10));
+
+  EXPECT_EQ(10u, copy.size());
+  EXPECT_EQ(1, ConstAt(copy, 1));
+  EXPECT_EQ(200, ConstAt(copy, 9));
+}
+
+TEST(CowPagedVector, PagesAreShared) {
+  auto original = Iota(10);
+  auto copy = original;
+
+  // the reads don't copy anything
+  EXPECT_EQ(&ConstAt(original, 0), &ConstAt(copy, 0));
+  EXPECT_EQ(&ConstAt(original, 5), &ConstAt(copy, 5));
+
+  // a write copies only its page, and only once
+  original[5] = 50;
+  const auto* copied = &ConstAt(original, 5);
+  EXPECT_NE(&ConstAt(copy, 5), copied);
+  EXPECT_EQ(&ConstAt(original, 0), &ConstAt(copy, 0));
+  original[6] = 60;
+  EXPECT_EQ(copied, &ConstAt(original, 5));
+  EXPECT_EQ(6, ConstAt(copy, 6));
+}
+
+TEST(CowPagedVector, CopyOfCopy) {
+  auto first = Iota(6);
+  auto second = first;
+  auto third = second;
+  second[0] = 1000;
+  third = second;
+  second[0] = 2000;
+  third[3] = 3000;
+
+  EXPECT_EQ(0, ConstAt(first, 0));
+  EXPECT_EQ(3, ConstAt(first, 3));
+  EXPECT_EQ(2000, ConstAt(second, 0));
+  EXPECT_EQ(3, ConstAt(second, 3));
+  EXPECT_EQ(1000, ConstAt(third, 0));
+  EXPECT_EQ(3000, ConstAt(third, 3));
+}
+
+TEST(CowPagedVector, Move) {
+  auto original = Iota(6);
+  auto copy = original;
+  auto moved = std::move(original);
+  EXPECT_TRUE(original.empty());
+  ASSERT_EQ(6u, moved.size());
+
+  moved[2] = 20;
+  EXPECT_EQ(20, ConstAt(moved, 2));
+  EXPECT_EQ(2, ConstAt(copy, 2));
+}
+
+TEST(CowPagedVector, PublishedCopyIsNotChanged) {
+  const int kCount = 1 << 12;
+  auto writer = Iota(kCount);
+  const auto published = writer;
+
+  std::thread reader([&] {
+    for (int repeat = 0; repeat < 16; ++repeat) {
+      for (int i = 0; i < kCount; ++i) {
+        ASSERT_EQ(i, published[i]);
+      }
+    }
+  });
+  for (int repeat = 0; repeat < 16; ++repeat) {
+    for (int i = 0; i < kCount; ++i) {
+      writer[i] = -i - repeat;
+    }
+    writer.push_back(repeat);
+  }
+  reader.join();
+
+  EXPECT_EQ(-1 - 15, ConstAt(writer, 1));
+  EXPECT_EQ(static_cast<size_t>(kCount), published.size());
+}
+
+} //namespace
@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "acc_class.h"
+#include "index_search.h"
+#include "random_pairs.h"
+
+using namespace crag;
+
+namespace {
+
+using Item = std::pair<ACPair, size_t>;
+
+bool KeyLessVal(const Item& lhs, const ACPair& rhs) {
+  return lhs.first < rhs;
+}
+
+std::vector<Item> SortedItems(std::vector<ACPair> pairs) {
+  std::sort(pairs.begin(), pairs.end());
+  pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+  std::vector<Item> items;
+  for (auto&& pair : pairs) {
+    items.emplace_back(pair, items.size());
+  }
+  return items;
+}
+
+//! Long pairs which differ only in the last letters, so they all have the same PairOrderKey
+std::vector<ACPair> SameKeyPairs(std::mt19937_64& engine, size_t count) {
+  auto first = RandomReducedWord(engine, CWord::kMaxLength);
+  std::vector<ACPair> pairs;
+  for (size_t i = 0; i < count; ++i) {
+    pairs.push_back(ACPair{first, RandomReducedWord(engine, 8)});
+  }
+  return pairs;
+}
+
+//! The items, half of them and some random pairs, in the sorted order
+std::vector<ACPair> Queries(std::mt19937_64& engine, const std::vector<Item>& items) {
+  std::vector<ACPair> queries;
+  for (size_t i = 0; i < items.size(); i += 2) {
+    queries.push_back(items[i].first);
+  }
+  for (size_t i = 0; i < std::max<size_t>(items.size(), 20u); ++i) {
+    queries.push_back(RandomIndexPair(engine));
+  }
+  auto same_key = SameKeyPairs(engine, 5);
+  queries.insert(queries.end(), same_key.begin(), same_key.end());
+  queries.push_back(ACPair{CWord("x"), CWord("y")});
+  queries.push_back(ACPair{RandomReducedWord(engine, CWord::kMaxLength), RandomReducedWord(engine, CWord::kMaxLength)});
+  std::sort(queries.begin(), queries.end());
+  return queries;
+}
+
+class IndexSearch : public ::testing::TestWithParam<size_t> { };
+
+TEST_P(IndexSearch, MatchesLowerBound) {
+  std::mt19937_64 engine(GetParam());
+  std::vector<ACPair> pairs;
+  for (size_t i = 0; i < GetParam(); ++i) {
+    pairs.push_back(RandomIndexPair(engine));
+  }
+  auto same_key = SameKeyPairs(engine, GetParam() / 4);
+  pairs.insert(pairs.end(), same_key.begin(), same_key.end());
+  auto items = SortedItems(pairs);
+
+  const auto* begin = items.data();
+  const auto* end = begin + items.size();
+  StaticSearchTree tree(items, [](const Item& item) { return PairOrderKey(item.first); });
+  EXPECT_EQ(items.empty(), tree.empty());
+
+  auto queries = Queries(engine, items);
+  const auto* galloping = begin;
+  for (auto&& query : queries) {
+    auto expected = std::lower_bound(begin, end, query, KeyLessVal);
+    ASSERT_EQ(expected, PrefetchingLowerBound(begin, end, query, KeyLessVal)) << query;
+    ASSERT_EQ(expected, GallopingLowerBound(begin, end, query, KeyLessVal)) << query;
+    if (!items.empty()) {
+      ASSERT_EQ(expected, tree.LowerBound(begin, end, PairOrderKey(query), query, KeyLessVal)) << query;
+    }
+
+    // the queries are sorted, so the search may continue from the previous result
+    galloping = GallopingLowerBound(galloping, end, query, KeyLessVal);
+    ASSERT_EQ(expected, galloping) << query;
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(Sizes, IndexSearch, ::testing::Values(0, 1, 5, 16, 17, 100, 256, 1000, 5000));
+
+TEST(StaticSearchTree, EqualKeysAcrossBlocks) {
+  // the whole array has a single key, so every search has to fall back to the array itself
+  std::mt19937_64 engine(3);
+  auto items = SortedItems(SameKeyPairs(engine, 10 * StaticSearchTree::kFanout));
+  ASSERT_EQ(PairOrderKey(items.front().first), PairOrderKey(items.back().first));
+
+  const auto* begin = items.data();
+  const auto* end = begin + items.size();
+  StaticSearchTree tree(items, [](const Item& item) { return PairOrderKey(item.first); });
+  for (auto&& item : items) {
+    ASSERT_EQ(&item, tree.LowerBound(begin, end, PairOrderKey(item.first), item.first, KeyLessVal));
+  }
+  for (auto&& query : SameKeyPairs(engine, 100)) {
+    ASSERT_EQ(std::lower_bound(begin, end, query, KeyLessVal),
+              tree.LowerBound(begin, end, PairOrderKey(query), query, KeyLessVal));
+  }
+}
+
+} //namespace
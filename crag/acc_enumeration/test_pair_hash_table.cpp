@@ -0,0 +1,139 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "pair_hash_table.h"
+
+namespace {
+
+using Item = std::pair<uint64_t, uint64_t>;
+
+//! Inserts the items, returns the ones which were already there with their values in the table
+std::vector<Item> Insert(PairHashTable* table, const std::vector<Item>& items) {
+  std::vector<Item> existing;
+  table->Insert(items.begin(), items.end(), [](const Item& item) { return item.first; },
+                [](const Item& item) { return item.second; },
+                [&](const Item& item, uint64_t value) { existing.emplace_back(item.first, value); });
+  return existing;
+}
+
+//! Values are derived from the keys, so that a reader can check them
+uint64_t ValueOf(uint64_t key) {
+  return key * 3 + 1;
+}
+
+TEST(PairHashTable, InsertAndFind) {
+  PairHashTable table(16);
+  EXPECT_EQ(0u, table.size());
+  EXPECT_FALSE(table.GetView().Find(5));
+
+  EXPECT_TRUE(Insert(&table, {{5, 50}, {0, 0}, {7, 70}}).empty());
+  EXPECT_EQ(3u, table.size());
+  auto view = table.GetView();
+  EXPECT_EQ(50u, view.Find(5).value());
+  EXPECT_EQ(0u, view.Find(0).value());
+  EXPECT_EQ(70u, view.Find(7).value());
+  EXPECT_FALSE(view.Find(6));
+}
+
+TEST(PairHashTable, Existing) {
+  PairHashTable table(16);
+  Insert(&table, {{1, 10}, {2, 20}});
+
+  auto existing = Insert(&table, {{2, 200}, {3, 30}, {1, 100}});
+  ASSERT_EQ(2u, existing.size());
+  EXPECT_EQ(Item(2, 20), existing[0]);
+  EXPECT_EQ(Item(1, 10), existing[1]);
+
+  // the old values are kept
+  EXPECT_EQ(3u, table.size());
+  EXPECT_EQ(10u, table.GetView().Find(1).value());
+  EXPECT_EQ(20u, table.GetView().Find(2).value());
+  EXPECT_EQ(30u, table.GetView().Find(3).value());
+}
+
+TEST(PairHashTable, Resize) {
+  PairHashTable table(16);
+  auto old_view = table.GetView();
+  auto old_bytes = table.BytesCount();
+
+  std::vector<Item> items;
+  for (uint64_t key = 0; key < 1000; ++key) {
+    items.emplace_back(key << 40u, ValueOf(key));
+  }
+  Insert(&table, items);
+
+  EXPECT_EQ(1000u, table.size());
+  EXPECT_LT(old_bytes, table.BytesCount());
+  auto view = table.GetView();
+  for (auto&& item : items) {
+    ASSERT_EQ(item.second, view.Find(item.first).value());
+  }
+
+  // the view of the old slots is still valid, it just doesn't see the moved keys
+  EXPECT_FALSE(old_view.Find(items.back().first));
+}
+
+TEST(PairHashTable, ConcurrentInsertsAcrossResizes) {
+  const uint64_t kThreads = 4;
+  const uint64_t kKeysPerThread = 20000;
+  const uint64_t kBatch = 100;
+  PairHashTable table(16);
+
+  std::atomic<bool> done{false};
+  std::atomic<size_t> wrong_values{0};
+  std::thread reader([&] {
+    uint64_t key = 0;
+    while (!done.load()) {
+      auto value = table.GetView().Find(key);
+      if (value && *value != ValueOf(key)) {
+        ++wrong_values;
+      }
+      key = (key + 7919) % (kThreads * kKeysPerThread);
+    }
+  });
+
+  std::vector<std::thread> writers;
+  std::vector<std::vector<Item>> existing(kThreads);
+  for (uint64_t thread = 0; thread < kThreads; ++thread) {
+    writers.emplace_back([&, thread] {
+      // every thread owns the keys equal to thread modulo kThreads, and inserts every batch twice
+      for (uint64_t first = 0; first < kKeysPerThread; first += kBatch) {
+        std::vector<Item> batch;
+        for (auto i = first; i < first + kBatch; ++i) {
+          auto key = i * kThreads + thread;
+          batch.emplace_back(key, ValueOf(key));
+        }
+        auto batch_existing = Insert(&table, batch);
+        EXPECT_TRUE(batch_existing.empty());
+        for (auto&& item : batch) {
+          item.second += 1;
+        }
+        batch_existing = Insert(&table, batch);
+        existing[thread].insert(existing[thread].end(), batch_existing.begin(), batch_existing.end());
+      }
+    });
+  }
+  for (auto&& writer : writers) {
+    writer.join();
+  }
+  done = true;
+  reader.join();
+
+  EXPECT_EQ(0u, wrong_values.load());
+  EXPECT_EQ(kThreads * kKeysPerThread, table.size());
+  auto view = table.GetView();
+  for (uint64_t key = 0; key < kThreads * kKeysPerThread; ++key) {
+    ASSERT_EQ(ValueOf(key), view.Find(key).value()) << key;
+  }
+  for (uint64_t thread = 0; thread < kThreads; ++thread) {
+    ASSERT_EQ(kKeysPerThread, existing[thread].size());
+    for (auto&& item : existing[thread]) {
+      ASSERT_EQ(ValueOf(item.first), item.second);
+    }
+  }
+}
+
+} //namespace
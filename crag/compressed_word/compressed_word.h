@@ -6,6 +6,7 @@
 #ifndef CRAG_COMPRESSED_WORD_H_
 #define CRAG_COMPRESSED_WORD_H_
 
+#include <array>
 #include <assert.h>
 #include <cstdint>
 #include <iostream>
@@ -158,8 +159,27 @@ public:
   }
 
   //! Proceeds to the next word in the defined order
+  /**
+   * The words are ordered by length and then lexicographically, only reduced words are produced. All words with a
+   * cancelling prefix are skipped at once, so this takes O(length) at most.
+   */
   inline constexpr CWord& ToNextWord();
 
+  //! Number of reduced words of length @p length, that is 4 * 3^(length - 1)
+  static constexpr inline uint64_t ReducedCount(size_type length);
+
+  //! Position of this word among the reduced words of the same length in the order of ToNextWord
+  constexpr inline uint64_t Rank() const;
+
+  //! The reduced word of length @p length with Rank() == @p rank
+  static constexpr inline CWord Unrank(size_type length, uint64_t rank);
+
+  //! Number of occurrences of every letter, indexed by Letter::AsInt()
+  constexpr inline std::array<size_type, 2 * kAlphabetSize> LetterCounts() const;
+
+  //! Sums of the exponents of x and y
+  constexpr inline std::array<int, kAlphabetSize> ExponentSums() const;
+
 private:
   size_type size_;   //!< The length of the word
   uint64_t letters_; //!< Main bit-compressed storage, every 2 bits is one letters
@@ -167,6 +187,31 @@ private:
   static const uint64_t kLetterMask = 3;  //!< Zeros extra bits besides the last two
   static const uint64_t kLetterShift = 2; //!< Lenght of shift which switches a single letter
   static const uint64_t kFullMask = ~uint64_t{0}; //!< 64 true bits
+  static const uint64_t kLowBitsMask = 0x5555555555555555ull; //!< The lower bit of every letter
+
+  //! Index of the lowest bit of the highest letter which has a nonzero bit, @p bits must be nonzero
+  static constexpr unsigned HighestBit(uint64_t bits) {
+#if defined(__GNUC__)
+    return static_cast<unsigned>((63 - __builtin_clzll(bits)) & ~1);
+#else
+    unsigned result = 0;
+    while (bits >>= kLetterShift) {
+      result += kLetterShift;
+    }
+    return result;
+#endif
+  }
+
+  static constexpr unsigned PopCount(uint64_t bits) {
+#if defined(__GNUC__)
+    return static_cast<unsigned>(__builtin_popcountll(bits));
+#else
+    bits = bits - ((bits >> 1) & kLowBitsMask);
+    bits = (bits & 0x3333333333333333ull) + ((bits >> 2) & 0x3333333333333333ull);
+    bits = (bits + (bits >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    return static_cast<unsigned>((bits * 0x0101010101010101ull) >> 56);
+#endif
+  }
 
   constexpr uint64_t current_mask() {
     if (size_) {
@@ -315,38 +360,99 @@ constexpr CWord CWord::Inverse() const {
 constexpr CWord& CWord::ToNextWord() {
   assert(~letters_ != 0 && "CWord is limited by length 32");
   auto new_letters = letters_ + 1;
-  if ((new_letters & current_mask()) == 0) {
-    //increase length and reset letters
-    assert(size_ != kMaxLength && "This should never happen since all Ys is a good word");
-    ++size_;
-    letters_ = 0; //all xs also has no cancellations
-    return *this;
-  }
+  //the pairs of adjacent letters are checked at once, there is a cancellation where the xor of neighbours is 01
+  const auto pairs_mask = current_mask() >> kLetterShift;
+  while (true) {
+    if ((new_letters & current_mask()) == 0) {
+      //increase length and reset letters
+      assert(size_ != kMaxLength && "This should never happen since all Ys is a good word");
+      ++size_;
+      letters_ = 0; //all xs also has no cancellations
+      return *this;
+    }
 
-  if (size_ == 1) {
-    letters_ = new_letters;
-    return *this;
-  }
+    const auto neighbours = new_letters ^ (new_letters >> kLetterShift);
+    const auto cancellations = neighbours & ~(neighbours >> 1) & kLowBitsMask & pairs_mask;
+    if (cancellations == 0) {
+      break;
+    }
 
-  auto checked_count = 1u; // Last letter is always fine
-  auto to_check = new_letters;
-  auto last_letter = Letter(to_check & CWord::kLetterMask);
-  while (checked_count < size_) {
-    to_check >>= CWord::kLetterShift;
-    auto current_letter = Letter(to_check & CWord::kLetterMask);
-    if (current_letter.Inverse() == last_letter) {
-      to_check = ++new_letters;
-      last_letter = Letter(to_check & CWord::kLetterMask);
-      checked_count = 1u;
-    } else {
-      last_letter = current_letter;
-      ++checked_count;
+    //all words with this prefix are not reduced, so the last letter of the prefix is increased
+    //and the rest is filled by the least letters which do not cancel
+    const auto shift = HighestBit(cancellations);
+    new_letters = ((new_letters >> shift) + 1) << shift;
+    if (((new_letters >> shift) & kLetterMask) == XYLetter('X').AsInt()) {
+      new_letters |= kLowBitsMask & ((uint64_t{1} << shift) - 1);
     }
   }
   letters_ = new_letters;
   return *this;
 }
 
+constexpr uint64_t CWord::ReducedCount(size_type length) {
+  if (length == 0) {
+    return 1;
+  }
+  uint64_t count = 2 * kAlphabetSize;
+  while (--length > 0) {
+    count *= 2 * kAlphabetSize - 1;
+  }
+  return count;
+}
+
+constexpr uint64_t CWord::Rank() const {
+  //the first letter is a digit in base 4 and all the other ones are in base 3, since the inverse of the previous
+  //letter is skipped
+  uint64_t rank = 0;
+  uint64_t previous_inverse = 2 * kAlphabetSize;
+  for (auto shift = kLetterShift * size_; shift > 0; ) {
+    shift -= kLetterShift;
+    const auto letter = (letters_ >> shift) & kLetterMask;
+    rank = rank * (previous_inverse == 2 * kAlphabetSize ? 2 * kAlphabetSize : 2 * kAlphabetSize - 1)
+        + letter - (letter > previous_inverse ? 1 : 0);
+    previous_inverse = letter ^ 1u;
+  }
+  return rank;
+}
+
+constexpr CWord CWord::Unrank(size_type length, uint64_t rank) {
+  assert(rank < ReducedCount(length));
+  uint64_t digits = 0;
+  for (size_type i = 1; i < length; ++i) {
+    digits |= (rank % (2 * kAlphabetSize - 1)) << (kLetterShift * (i - 1));
+    rank /= 2 * kAlphabetSize - 1;
+  }
+
+  CWord result;
+  if (length == 0) {
+    return result;
+  }
+  uint64_t letter = rank;
+  result.letters_ = letter;
+  for (size_type i = 1; i < length; ++i) {
+    const auto digit = (digits >> (kLetterShift * (length - 1 - i))) & kLetterMask;
+    letter = digit + (digit >= (letter ^ 1u) ? 1 : 0);
+    result.letters_ = (result.letters_ << kLetterShift) | letter;
+  }
+  result.size_ = length;
+  return result;
+}
+
+constexpr std::array<CWord::size_type, 2 * CWord::kAlphabetSize> CWord::LetterCounts() const {
+  //the lower bit is the inversion flag and the higher one tells y from x, unused bits are always zero
+  const auto inverted = letters_ & kLowBitsMask;
+  const auto is_y = (letters_ >> 1) & kLowBitsMask;
+  const auto X_count = static_cast<size_type>(PopCount(inverted & ~is_y));
+  const auto y_count = static_cast<size_type>(PopCount(is_y & ~inverted));
+  const auto Y_count = static_cast<size_type>(PopCount(inverted & is_y));
+  return {{static_cast<size_type>(size_ - X_count - y_count - Y_count), X_count, y_count, Y_count}};
+}
+
+constexpr std::array<int, CWord::kAlphabetSize> CWord::ExponentSums() const {
+  const auto counts = LetterCounts();
+  return {{counts[0] - counts[1], counts[2] - counts[3]}};
+}
+
 constexpr CWord::CWord(Dump d)
   : size_(d.length)
   , letters_(d.letters)
@@ -393,6 +499,15 @@ inline std::string ToString(CWord w) {
   return out;
 }
 
+//! Writes ExponentSums() of every word in [@p begin, @p end) to @p out
+template<typename InputIterator, typename OutputIterator>
+OutputIterator ExponentSums(InputIterator begin, InputIterator end, OutputIterator out) {
+  for (; begin != end; ++begin, ++out) {
+    *out = begin->ExponentSums();
+  }
+  return out;
+}
+
 class RandomWord {
 public:
   RandomWord(size_t min_size, size_t max_size)
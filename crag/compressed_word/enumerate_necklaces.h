@@ -0,0 +1,269 @@
+#ifndef ACC_ENUMERATE_NECKLACES_H
+#define ACC_ENUMERATE_NECKLACES_H
+
+#include <array>
+#include <cstdlib>
+#include <vector>
+
+#include "compressed_word.h"
+
+namespace crag {
+
+//! Set of the exponent sums which the enumerated words may have
+/**
+ * Besides the check of a complete word, it tells if a prefix can be extended to a reduced word with allowed sums.
+ * This uses a table of the sums of all reduced words of every length, computed once by a DP over the length.
+ */
+class ExponentSumsFilter {
+ public:
+  using Sums = std::array<int, CWord::kAlphabetSize>;
+
+  explicit ExponentSumsFilter(std::vector<Sums> allowed)
+      : allowed_(std::move(allowed))
+  { }
+
+  //! Sums of words v of length @p length such that the abelianisation of <x, y | u, v> is trivial
+  static ExponentSumsFilter TrivialAbelianisation(const Sums& u_sums, CWord::size_type length) {
+    std::vector<Sums> allowed;
+    for (int a = -length; a <= length; ++a) {
+      for (int b = -length; b <= length; ++b) {
+        if (std::abs(u_sums[0] * b - a * u_sums[1]) == 1 && IsReachable(length, kNoLetter, a, b)) {
+          allowed.push_back(Sums{{a, b}});
+        }
+      }
+    }
+    return ExponentSumsFilter(std::move(allowed));
+  }
+
+  bool Empty() const {
+    return allowed_.empty();
+  }
+
+  //! Checks if a reduced word with sums @p prefix_sums which ends with @p last can be extended by @p remaining letters
+  bool AllowsPrefix(const Sums& prefix_sums, unsigned last, CWord::size_type remaining) const {
+    for (auto&& sums : allowed_) {
+      if (IsReachable(remaining, last, sums[0] - prefix_sums[0], sums[1] - prefix_sums[1])) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  //! Change of the sums made by @p letter
+  static Sums LetterSums(unsigned letter) {
+    return letter < 2 ? Sums{{letter == 0 ? 1 : -1, 0}} : Sums{{0, letter == 2 ? 1 : -1}};
+  }
+
+ private:
+  static constexpr int kMaxSum = CWord::kMaxLength;
+  static constexpr int kSumsCount = 2 * kMaxSum + 1;
+  static constexpr unsigned kNoLetter = 2 * CWord::kAlphabetSize; //!< Used for the empty prefix
+
+  std::vector<Sums> allowed_;
+
+  //! Checks if there is a reduced word of length @p length which doesn't start with the inverse of @p last
+  static bool IsReachable(CWord::size_type length, unsigned last, int a, int b) {
+    if (std::abs(a) + std::abs(b) > length) {
+      return false;
+    }
+    return Reachable()[Index(length, last, a, b)];
+  }
+
+  static size_t Index(CWord::size_type length, unsigned last, int a, int b) {
+    return ((static_cast<size_t>(length) * (kNoLetter + 1) + last) * kSumsCount + (a + kMaxSum)) * kSumsCount
+        + (b + kMaxSum);
+  }
+
+  static const std::vector<bool>& Reachable() {
+    static const std::vector<bool> reachable = [] {
+      std::vector<bool> result(Index(CWord::kMaxLength + 1, 0, -kMaxSum, -kMaxSum), false);
+      for (unsigned last = 0; last <= kNoLetter; ++last) {
+        result[Index(0, last, 0, 0)] = true;
+      }
+      for (CWord::size_type length = 1; length <= CWord::kMaxLength; ++length) {
+        for (unsigned last = 0; last <= kNoLetter; ++last) {
+          for (unsigned first = 0; first < kNoLetter; ++first) {
+            if (first == (last ^ 1u)) {
+              continue;
+            }
+            auto shift = LetterSums(first);
+            for (int a = -(length - 1); a <= length - 1; ++a) {
+              for (int b = -(length - 1); b <= length - 1; ++b) {
+                if (result[Index(length - 1, first, a, b)]) {
+                  result[Index(length, last, a + shift[0], b + shift[1])] = true;
+                }
+              }
+            }
+          }
+        }
+      }
+      return result;
+    }();
+    return reachable;
+  }
+};
+
+//! Enumerates the cyclically reduced words which are minimal among their cyclic permutations and the ones of inverse
+/**
+ * These are exactly the words w with ConjugationInverseNormalForm(w) == w, they are produced in the same order
+ * as EnumerateWords does. Words minimal under rotations are the necklaces, which are generated with the FKM
+ * algorithm: a prefix is only extended by letters which keep it a reduced prenecklace, so the words which are not
+ * normal are mostly never constructed. The only check performed on the full word is the comparison with the inverse.
+ */
+class EnumerateNecklaces
+{
+  class Iter {
+   public:
+    Iter(CWord::size_type length, CWord::size_type end_length, const ExponentSumsFilter* filter)
+        : length_(length)
+        , end_length_(end_length)
+        , filter_(filter)
+    {
+      Start();
+    }
+
+    Iter& operator++() {
+      if (length_ == 0 || !NextOfLength(static_cast<CWord::size_type>(length_ - 1), letters_[length_ - 1] + 1u)) {
+        ++length_;
+        Start();
+      }
+      return *this;
+    }
+
+    const CWord& operator*() const {
+      return word_;
+    }
+
+    bool operator==(const Iter& other) const {
+      return word_ == other.word_;
+    }
+
+    bool operator!=(const Iter& other) const {
+      return word_ != other.word_;
+    }
+
+   private:
+    static constexpr unsigned kLettersCount = 2 * CWord::kAlphabetSize;
+
+    CWord::size_type length_;
+    CWord::size_type end_length_;
+    const ExponentSumsFilter* filter_;
+    CWord word_;
+
+    std::array<unsigned, CWord::kMaxLength> letters_{};
+    std::array<CWord::size_type, CWord::kMaxLength + 1> period_{}; //!< period_[t] is the period of first t letters
+    std::array<uint64_t, CWord::kMaxLength + 1> prefix_{};  //!< prefix_[t] is the packed first t letters
+    std::array<ExponentSumsFilter::Sums, CWord::kMaxLength + 1> sums_{}; //!< sums_[t] are the sums of first t letters
+
+    //! Finds the first word of length_ or of the next lengths
+    void Start() {
+      for (; length_ < end_length_; ++length_) {
+        if (length_ == 0) {
+          word_ = CWord();
+          return;
+        }
+        if (NextOfLength(0, 0)) {
+          return;
+        }
+      }
+      word_ = CWord(CWord::Dump{end_length_, 0});
+    }
+
+    //! Finds the next word where the letter at @p pos is at least @p start, returns false if there is none of length_
+    bool NextOfLength(CWord::size_type pos, unsigned start) {
+      while (true) {
+        auto letter = start;
+        while (letter < kLettersCount && pos > 0 && letter == (letters_[pos - 1] ^ 1u)) {
+          ++letter;
+        }
+
+        if (letter >= kLettersCount) {
+          if (pos == 0) {
+            return false;
+          }
+          --pos;
+          start = letters_[pos] + 1;
+          continue;
+        }
+
+        if (filter_) {
+          auto letter_sums = ExponentSumsFilter::LetterSums(letter);
+          sums_[pos + 1] = ExponentSumsFilter::Sums{{sums_[pos][0] + letter_sums[0], sums_[pos][1] + letter_sums[1]}};
+          if (!filter_->AllowsPrefix(sums_[pos + 1], letter, static_cast<CWord::size_type>(length_ - pos - 1))) {
+            start = letter + 1;
+            continue;
+          }
+        }
+
+        letters_[pos] = letter;
+        period_[pos + 1] = (pos == 0 || letter > letters_[pos - period_[pos]]) ? pos + 1 : period_[pos];
+        prefix_[pos + 1] = (prefix_[pos] << 2) | letter;
+        ++pos;
+
+        if (pos < length_) {
+          start = letters_[pos - period_[pos]];
+          continue;
+        }
+
+        if (length_ % period_[length_] == 0 && letters_[length_ - 1] != (letters_[0] ^ 1u)) {
+          auto candidate = CWord(CWord::Dump{length_, prefix_[length_]});
+          if (IsLeastInverse(candidate)) {
+            word_ = candidate;
+            return true;
+          }
+        }
+
+        --pos;
+        start = letters_[pos] + 1;
+      }
+    }
+
+    //! Checks that no cyclic permutation of the inverse is less than @p w
+    static bool IsLeastInverse(const CWord& w) {
+      auto inverse = w.Inverse();
+      for (auto shift = 0u; shift < w.size(); ++shift, inverse.CyclicLeftShift()) {
+        if (inverse < w) {
+          return false;
+        }
+      }
+      return true;
+    }
+  };
+
+  CWord::size_type min_length_;
+  CWord::size_type end_length_;
+  bool use_filter_ = false;
+  ExponentSumsFilter filter_{{}};
+
+ public:
+  EnumerateNecklaces(CWord::size_type length)
+      : min_length_(length)
+      , end_length_(static_cast<CWord::size_type>(length + 1)) {
+  }
+
+  EnumerateNecklaces(CWord::size_type min_length, CWord::size_type end_length)
+      : min_length_(min_length)
+      , end_length_(end_length) {
+    assert(min_length < end_length);
+  }
+
+  //! Only the words with exponent sums allowed by @p filter
+  EnumerateNecklaces(CWord::size_type length, ExponentSumsFilter filter)
+      : min_length_(length)
+      , end_length_(static_cast<CWord::size_type>(length + 1))
+      , use_filter_(true)
+      , filter_(std::move(filter)) {
+  }
+
+  Iter begin() const {
+    return Iter(min_length_, end_length_, use_filter_ ? &filter_ : nullptr);
+  }
+
+  Iter end() const {
+    return Iter(end_length_, end_length_, use_filter_ ? &filter_ : nullptr);
+  }
+};
+
+} //crag
+
+#endif //ACC_ENUMERATE_NECKLACES_H
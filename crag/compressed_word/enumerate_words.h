@@ -43,39 +43,55 @@ class EnumerateWords
     }
   };
 
-  CWord::size_type min_length_;
-  CWord::size_type end_length_ = static_cast<CWord::size_type>(min_length_ + 1);
+  CWord begin_;
+  CWord end_;
   bool cyclic_reduced_ = false;
 
-  constexpr EnumerateWords(CWord::size_type min_length, CWord::size_type end_length, bool cyclic_reduced)
-      : min_length_(min_length), end_length_(end_length), cyclic_reduced_(cyclic_reduced) {
-    assert(min_length < end_length);
+  static constexpr CWord First(CWord::size_type length) {
+    return CWord(CWord::Dump{length, 0});
+  }
+
+  //! The word with @p rank or the first word of the next length
+  static constexpr CWord RankedOrNext(CWord::size_type length, uint64_t rank) {
+    assert(rank <= CWord::ReducedCount(length));
+    return rank == CWord::ReducedCount(length)
+        ? First(static_cast<CWord::size_type>(length + 1))
+        : CWord::Unrank(length, rank);
   }
 
+  constexpr EnumerateWords(CWord begin, CWord end, bool cyclic_reduced)
+      : begin_(begin), end_(end), cyclic_reduced_(cyclic_reduced) {
+    assert(begin <= end);
+  }
 
  public:
   constexpr EnumerateWords(CWord::size_type length)
-      : min_length_(length) {
+      : begin_(First(length)), end_(First(static_cast<CWord::size_type>(length + 1))) {
   }
 
   constexpr EnumerateWords(CWord::size_type min_length, CWord::size_type end_length)
-      : min_length_(min_length), end_length_(end_length) {
+      : begin_(First(min_length)), end_(First(end_length)) {
     assert(min_length < end_length);
   }
 
   constexpr Iter begin() const {
-    return Iter{CWord(min_length_, XYLetter('x')), cyclic_reduced_};
+    return Iter{begin_, cyclic_reduced_};
   }
 
   constexpr Iter end() const {
-    return Iter{CWord(end_length_, XYLetter('x')), cyclic_reduced_};
+    return Iter{end_, cyclic_reduced_};
   }
 
   static constexpr EnumerateWords CyclicReduced(CWord::size_type length) {
-    return EnumerateWords(length, static_cast<CWord::size_type>(length + 1), true);
+    return EnumerateWords(First(length), First(static_cast<CWord::size_type>(length + 1)), true);
   }
   static constexpr EnumerateWords CyclicReduced(CWord::size_type min_length, CWord::size_type end_length) {
-    return EnumerateWords(min_length, end_length, true);
+    return EnumerateWords(First(min_length), First(end_length), true);
+  }
+
+  //! Words of length @p length with CWord::Rank() in [@p from_rank, @p to_rank)
+  static constexpr EnumerateWords Range(CWord::size_type length, uint64_t from_rank, uint64_t to_rank) {
+    return EnumerateWords(RankedOrNext(length, from_rank), RankedOrNext(length, to_rank), false);
   }
 };
 
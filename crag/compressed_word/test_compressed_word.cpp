@@ -1,9 +1,12 @@
 #include "gtest/gtest.h"
 #include "compressed_word.h"
+#include "enumerate_words.h"
 #include "longest_common_subword_cyclic.h"
 
 #include <chrono>
+#include <iterator>
 #include <memory>
+#include <vector>
 
 namespace crag {
 
@@ -116,6 +119,113 @@ TEST(CWord, Enumerate1) {
   EXPECT_EQ(CWord("xxx"), a.ToNextWord());
 }
 
+TEST(CWord, EnumerateAllReduced) {
+  //compare with the check of every sequence of letters
+  CWord w{};
+  for (CWord::size_type length = 1; length < 8; ++length) {
+    uint64_t rank = 0;
+    for (uint64_t letters = 0; letters < (uint64_t{1} << (2 * length)); ++letters) {
+      auto is_reduced = true;
+      for (auto i = 0u; i + 1 < length; ++i) {
+        if ((((letters >> (2 * i)) ^ (letters >> (2 * i + 2))) & 3u) == 1u) {
+          is_reduced = false;
+        }
+      }
+      if (!is_reduced) {
+        continue;
+      }
+      w.ToNextWord();
+      ASSERT_EQ(CWord(CWord::Dump{length, letters}), w);
+      EXPECT_EQ(rank, w.Rank());
+      EXPECT_EQ(w, CWord::Unrank(length, rank));
+      ++rank;
+    }
+    EXPECT_EQ(CWord::ReducedCount(length), rank);
+  }
+}
+
+TEST(CWord, RankLong) {
+  std::mt19937_64 engine(0);
+  RandomWord random_word(CWord::kMaxLength, CWord::kMaxLength);
+  for (auto i = 0u; i < 1000; ++i) {
+    auto w = random_word(engine);
+    EXPECT_EQ(w, CWord::Unrank(w.size(), w.Rank()));
+    if (w.Rank() + 1 < CWord::ReducedCount(w.size())) {
+      auto next = w;
+      next.ToNextWord();
+      EXPECT_EQ(w.Rank() + 1, next.Rank());
+    }
+  }
+
+  auto last = CWord::Unrank(CWord::kMaxLength, CWord::ReducedCount(CWord::kMaxLength) - 1);
+  CWord ys;
+  while (ys.size() < CWord::kMaxLength) {
+    ys.PushBack(XYLetter('Y'));
+  }
+  EXPECT_EQ(ys, last);
+}
+
+TEST(EnumerateWords, Range) {
+  const CWord::size_type length = 6;
+  std::vector<CWord> all;
+  for (auto&& w : EnumerateWords(length)) {
+    all.push_back(w);
+  }
+  ASSERT_EQ(CWord::ReducedCount(length), all.size());
+
+  std::vector<CWord> ranges;
+  const uint64_t bounds[] = {0, 1, 17, 100, 500, CWord::ReducedCount(length)};
+  for (auto i = 0u; i + 1 < sizeof(bounds) / sizeof(bounds[0]); ++i) {
+    for (auto&& w : EnumerateWords::Range(length, bounds[i], bounds[i + 1])) {
+      ranges.push_back(w);
+    }
+  }
+  EXPECT_EQ(all, ranges);
+}
+
+TEST(CWord, LetterCounts) {
+  constexpr auto counts = CWord("xxYXy").LetterCounts();
+  static_assert(counts[0] == 2 && counts[3] == 1, "LetterCounts must be constexpr");
+  constexpr auto sums = CWord("xxyXY").ExponentSums();
+  static_assert(sums[0] == 1 && sums[1] == 0, "ExponentSums must be constexpr");
+
+  using Counts = std::array<CWord::size_type, 4>;
+  EXPECT_EQ((Counts{{0, 0, 0, 0}}), CWord().LetterCounts());
+  EXPECT_EQ((Counts{{2, 1, 1, 1}}), CWord("xxyXY").LetterCounts());
+
+  CWord ys, xs;
+  while (ys.size() < CWord::kMaxLength) {
+    ys.PushBack(XYLetter('Y'));
+    xs.PushBack(XYLetter('x'));
+  }
+  EXPECT_EQ((Counts{{0, 0, 0, 32}}), ys.LetterCounts());
+  EXPECT_EQ((Counts{{32, 0, 0, 0}}), xs.LetterCounts());
+}
+
+TEST(CWord, ExponentSumsRandom) {
+  std::mt19937_64 engine(0);
+  RandomWord random_word(0, CWord::kMaxLength);
+  std::vector<CWord> words;
+  for (auto i = 0u; i < 1000; ++i) {
+    words.push_back(random_word(engine));
+  }
+
+  std::vector<std::array<int, 2>> sums;
+  ExponentSums(words.begin(), words.end(), std::back_inserter(sums));
+  ASSERT_EQ(words.size(), sums.size());
+
+  for (size_t i = 0; i < words.size(); ++i) {
+    std::array<int, 4> naive = {{0, 0, 0, 0}};
+    for (auto w = words[i]; !w.Empty(); w.PopFront()) {
+      ++naive[w.GetFront().AsInt()];
+    }
+    auto counts = words[i].LetterCounts();
+    EXPECT_TRUE(std::equal(naive.begin(), naive.end(), counts.begin())) << words[i];
+    EXPECT_EQ(naive[0] - naive[1], sums[i][0]) << words[i];
+    EXPECT_EQ(naive[2] - naive[3], sums[i][1]) << words[i];
+  }
+}
+
 
 
 
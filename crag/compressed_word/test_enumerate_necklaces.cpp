@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "enumerate_necklaces.h"
+#include "enumerate_words.h"
+#include "tuple_normal_form.h"
+
+namespace crag { namespace {
+
+std::vector<CWord> NaiveNormalWords(CWord::size_type min_length, CWord::size_type end_length) {
+  std::vector<CWord> result;
+  for (auto&& w : EnumerateWords(min_length, end_length)) {
+    if (!w.Empty() && w.GetFront() == w.GetBack().Inverse()) {
+      continue;
+    }
+    if (ConjugationInverseNormalForm(w) == w) {
+      result.push_back(w);
+    }
+  }
+  return result;
+}
+
+TEST(EnumerateNecklaces, Short) {
+  std::vector<CWord> words;
+  for (auto&& w : EnumerateNecklaces(0, 3)) {
+    words.push_back(w);
+  }
+  EXPECT_EQ(std::vector<CWord>({CWord(), CWord("x"), CWord("y"), CWord("xx"), CWord("xy"), CWord("xY"), CWord("yy")}),
+            words);
+}
+
+TEST(EnumerateNecklaces, CompareWithNaive) {
+  for (CWord::size_type length = 0; length < 11; ++length) {
+    std::vector<CWord> words;
+    for (auto&& w : EnumerateNecklaces(length)) {
+      words.push_back(w);
+    }
+    EXPECT_EQ(NaiveNormalWords(length, length + 1), words) << length;
+  }
+
+  std::vector<CWord> words;
+  for (auto&& w : EnumerateNecklaces(2, 9)) {
+    words.push_back(w);
+  }
+  EXPECT_EQ(NaiveNormalWords(2, 9), words);
+}
+
+TEST(EnumerateNecklaces, TrivialAbelianisation) {
+  for (auto&& u : {CWord("x"), CWord("xy"), CWord("xxY"), CWord("xxyXy"), CWord("xyXY")}) {
+    auto u_sums = u.ExponentSums();
+    for (CWord::size_type length = 1; length < 10; ++length) {
+      std::vector<CWord> expected;
+      for (auto&& v : EnumerateNecklaces(length)) {
+        auto v_sums = v.ExponentSums();
+        if (std::abs(u_sums[0] * v_sums[1] - v_sums[0] * u_sums[1]) == 1) {
+          expected.push_back(v);
+        }
+      }
+
+      std::vector<CWord> words;
+      for (auto&& v : EnumerateNecklaces(length, ExponentSumsFilter::TrivialAbelianisation(u_sums, length))) {
+        words.push_back(v);
+      }
+      EXPECT_EQ(expected, words) << u << " " << length;
+    }
+  }
+}
+
+}}
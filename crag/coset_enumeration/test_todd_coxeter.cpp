@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+
+#include "todd_coxeter.h"
+
+namespace crag { namespace {
+
+using Result = ToddCoxeter::Result;
+
+const auto kBudget = std::chrono::seconds(10);
+
+size_t GroupOrder(const char* u, const char* v) {
+  ToddCoxeter enumeration(CWordTuple<2>{CWord(u), CWord(v)});
+  EXPECT_EQ(Result::kComplete, enumeration.Enumerate(kBudget)) << u << " " << v;
+  return enumeration.size();
+}
+
+TEST(ToddCoxeter, Trivial) {
+  EXPECT_EQ(1u, GroupOrder("x", "y"));
+  EXPECT_EQ(1u, GroupOrder("xY", "xxY"));
+}
+
+TEST(ToddCoxeter, Cyclic) {
+  EXPECT_EQ(5u, GroupOrder("xxxxx", "yX"));
+  EXPECT_EQ(6u, GroupOrder("xxxxxx", "y"));
+}
+
+TEST(ToddCoxeter, Quaternion) {
+  EXPECT_EQ(8u, GroupOrder("xxYY", "xyxyXX"));
+}
+
+TEST(ToddCoxeter, Dicyclic) {
+  //<x, y | x^n = y^2, y^-1 x y = x^-1> has order 4n
+  EXPECT_EQ(12u, GroupOrder("xxxYY", "Yxyx"));
+  EXPECT_EQ(20u, GroupOrder("xxxxxYY", "Yxyx"));
+}
+
+TEST(ToddCoxeter, Higman) {
+  //x^y = x^2, y^x = y^2 is a presentation of the trivial group
+  EXPECT_EQ(1u, GroupOrder("YxyXX", "XyxYY"));
+}
+
+TEST(ToddCoxeter, AbelianisationDividesOrder) {
+  //the order of the abelianisation is the determinant of the exponent sums matrix
+  std::mt19937_64 engine(17);
+  RandomWord rw(1, 8);
+
+  auto ExponentSums = [](CWord w) {
+    std::array<int, 2> result{};
+    for (; !w.Empty(); w.PopFront()) {
+      auto letter = w.GetFront().AsInt();
+      result[letter / 2] += (letter % 2 == 0) ? 1 : -1;
+    }
+    return result;
+  };
+
+  auto complete_count = 0u;
+  for (auto repeat = 0u; repeat < 300u; ++repeat) {
+    auto u = rw(engine);
+    auto v = rw(engine);
+    ToddCoxeter enumeration(CWordTuple<2>{u, v}, 1u << 12);
+    if (enumeration.Enumerate(std::chrono::milliseconds(100)) != Result::kComplete) {
+      continue;
+    }
+    ++complete_count;
+    auto u_sums = ExponentSums(u);
+    auto v_sums = ExponentSums(v);
+    auto determinant = std::abs(u_sums[0] * v_sums[1] - u_sums[1] * v_sums[0]);
+    ASSERT_NE(0, determinant) << u << " " << v;
+    ASSERT_EQ(0u, enumeration.size() % determinant) << u << " " << v << " " << enumeration.size();
+  }
+  EXPECT_LT(0u, complete_count);
+}
+
+TEST(ToddCoxeter, InfiniteGroup) {
+  //free product of Z_2 and Z_3
+  ToddCoxeter enumeration(CWordTuple<2>{CWord("xx"), CWord("yyy")}, 1000);
+  EXPECT_EQ(Result::kMemoryLimit, enumeration.Enumerate(kBudget));
+  EXPECT_GE(1000u, enumeration.size());
+}
+
+TEST(ToddCoxeter, TimeLimit) {
+  ToddCoxeter enumeration(CWordTuple<2>{CWord("xx"), CWord("yyy")});
+  EXPECT_EQ(Result::kTimeLimit, enumeration.Enumerate(std::chrono::steady_clock::duration::zero()));
+}
+
+} }
@@ -0,0 +1,292 @@
+#include "todd_coxeter.h"
+
+namespace crag {
+
+constexpr size_t ToddCoxeter::kDefaultCosetsLimit;
+constexpr ToddCoxeter::Coset ToddCoxeter::kNone;
+constexpr size_t ToddCoxeter::kLabels;
+constexpr size_t ToddCoxeter::kMaxDeductions;
+constexpr size_t ToddCoxeter::kInitialCapacity;
+
+ToddCoxeter::ToddCoxeter(const CWordTuple<2>& relators, size_t cosets_limit)
+    : cosets_limit_(std::max<size_t>(cosets_limit, 1u)) {
+  for (auto relator : relators) {
+    relator.CyclicReduce();
+    if (relator.Empty()) {
+      continue;
+    }
+    relators_.push_back(relator);
+
+    for (auto word : {relator, relator.Inverse()}) {
+      for (auto shift = 0u; shift < word.size(); ++shift, word.CyclicLeftShift()) {
+        conjugates_[word.GetFront().AsInt()].push_back(word);
+      }
+    }
+  }
+
+  //the coset of the trivial subgroup
+  table_.reserve(kLabels * kInitialCapacity);
+  parent_.reserve(kInitialCapacity);
+  table_.assign(kLabels, kNone);
+  parent_.push_back(0);
+  live_cosets_ = 1;
+  defined_cosets_ = 1;
+}
+
+ToddCoxeter::Coset ToddCoxeter::Find(Coset c) {
+  while (parent_[c] != c) {
+    parent_[c] = parent_[parent_[c]];
+    c = parent_[c];
+  }
+  return c;
+}
+
+bool ToddCoxeter::Define(Coset c, Word::Letter l) {
+  if (parent_.size() >= cosets_limit_) {
+    return false;
+  }
+  auto d = static_cast<Coset>(parent_.size());
+  table_.resize(table_.size() + kLabels, kNone);
+  parent_.push_back(d);
+  ++live_cosets_;
+  ++defined_cosets_;
+  Deduce(c, l, d);
+  return true;
+}
+
+void ToddCoxeter::Deduce(Coset c, Word::Letter l, Coset d) {
+  Entry(c, l) = d;
+  Entry(d, l.Inverse()) = c;
+  if (deductions_.size() < kMaxDeductions) {
+    deductions_.push_back(Deduction{c, l});
+  }
+}
+
+void ToddCoxeter::Merge(Coset c, Coset d) {
+  c = Find(c);
+  d = Find(d);
+  if (c == d) {
+    return;
+  }
+  if (d < c) {
+    std::swap(c, d);
+  }
+  parent_[d] = c;
+  --live_cosets_;
+  coincidences_.push_back(d);
+}
+
+void ToddCoxeter::Coincidence(Coset c, Coset d) {
+  coincidences_.clear();
+  Merge(c, d);
+  for (size_t i = 0; i < coincidences_.size(); ++i) {
+    auto dead = coincidences_[i];
+    for (Word::Letter l = 0; l.AsInt() < kLabels; ++l) {
+      auto terminus = Entry(dead, l);
+      if (terminus == kNone) {
+        continue;
+      }
+      Entry(terminus, l.Inverse()) = kNone;
+
+      auto origin = Find(dead);
+      terminus = Find(terminus);
+      if (Entry(origin, l) != kNone) {
+        Merge(terminus, Entry(origin, l));
+      } else if (Entry(terminus, l.Inverse()) != kNone) {
+        Merge(origin, Entry(terminus, l.Inverse()));
+      } else {
+        Deduce(origin, l, terminus);
+      }
+    }
+  }
+}
+
+bool ToddCoxeter::ScanAndFill(Coset c, Word w) {
+  auto forward = c;
+  auto backward = c;
+  while (true) {
+    while (!w.Empty() && Entry(forward, w.GetFront()) != kNone) {
+      forward = Entry(forward, w.GetFront());
+      w.PopFront();
+    }
+    if (w.Empty()) {
+      if (forward != backward) {
+        Coincidence(forward, backward);
+      }
+      return true;
+    }
+
+    while (!w.Empty() && Entry(backward, w.GetBack().Inverse()) != kNone) {
+      backward = Entry(backward, w.GetBack().Inverse());
+      w.PopBack();
+    }
+    if (w.Empty()) {
+      Coincidence(forward, backward);
+      return true;
+    }
+    if (w.size() == 1) {
+      Deduce(forward, w.GetFront(), backward);
+      return true;
+    }
+
+    if (!Define(forward, w.GetFront())) {
+      return false;
+    }
+  }
+}
+
+void ToddCoxeter::Scan(Coset c, Word w) {
+  auto forward = c;
+  while (!w.Empty() && Entry(forward, w.GetFront()) != kNone) {
+    forward = Entry(forward, w.GetFront());
+    w.PopFront();
+  }
+  if (w.Empty()) {
+    if (forward != c) {
+      Coincidence(forward, c);
+    }
+    return;
+  }
+
+  auto backward = c;
+  while (!w.Empty() && Entry(backward, w.GetBack().Inverse()) != kNone) {
+    backward = Entry(backward, w.GetBack().Inverse());
+    w.PopBack();
+  }
+  if (w.Empty()) {
+    Coincidence(forward, backward);
+  } else if (w.size() == 1) {
+    Deduce(forward, w.GetFront(), backward);
+  }
+}
+
+void ToddCoxeter::ProcessDeductions() {
+  while (!deductions_.empty()) {
+    auto deduction = deductions_.back();
+    deductions_.pop_back();
+
+    if (!IsLive(deduction.coset)) {
+      continue;
+    }
+    for (auto&& w : conjugates_[deduction.label.AsInt()]) {
+      Scan(deduction.coset, w);
+      if (!IsLive(deduction.coset)) {
+        break;
+      }
+    }
+
+    if (!IsLive(deduction.coset) || Entry(deduction.coset, deduction.label) == kNone) {
+      continue;
+    }
+    auto terminus = Entry(deduction.coset, deduction.label);
+    for (auto&& w : conjugates_[deduction.label.Inverse().AsInt()]) {
+      Scan(terminus, w);
+      if (!IsLive(terminus)) {
+        break;
+      }
+    }
+  }
+}
+
+bool ToddCoxeter::Lookahead() {
+  auto cosets_count = parent_.size();
+  for (Coset c = 0; c < parent_.size(); ++c) {
+    for (auto&& w : relators_) {
+      if (!IsLive(c)) {
+        break;
+      }
+      Scan(c, w);
+    }
+    ProcessDeductions();
+  }
+  Compact();
+  return parent_.size() < cosets_count;
+}
+
+void ToddCoxeter::Compact() {
+  //cosets are renumbered keeping the order, so that HLT may proceed from the same place
+  std::vector<Coset> new_index(parent_.size(), kNone);
+  Coset next = 0;
+  size_t new_current = parent_.size();
+  for (Coset c = 0; c < parent_.size(); ++c) {
+    if (c >= current_ && new_current == parent_.size()) {
+      new_current = next;
+    }
+    if (IsLive(c)) {
+      new_index[c] = next++;
+    }
+  }
+  current_ = std::min<size_t>(new_current, next);
+
+  for (Coset c = 0; c < parent_.size(); ++c) {
+    if (!IsLive(c)) {
+      continue;
+    }
+    for (size_t l = 0; l < kLabels; ++l) {
+      auto entry = table_[kLabels * c + l];
+      table_[kLabels * new_index[c] + l] = entry == kNone ? kNone : new_index[entry];
+    }
+  }
+
+  table_.resize(kLabels * next);
+  parent_.resize(next);
+  for (Coset c = 0; c < next; ++c) {
+    parent_[c] = c;
+  }
+
+  auto deductions_end = deductions_.begin();
+  for (auto&& deduction : deductions_) {
+    if (new_index[deduction.coset] != kNone) {
+      *deductions_end++ = Deduction{new_index[deduction.coset], deduction.label};
+    }
+  }
+  deductions_.erase(deductions_end, deductions_.end());
+}
+
+ToddCoxeter::Result ToddCoxeter::Enumerate(std::chrono::steady_clock::duration time_budget) {
+  static const size_t kCosetsBetweenClockChecks = 256;
+  auto deadline = std::chrono::steady_clock::now() + time_budget;
+
+  size_t until_clock_check = 0;
+  while (current_ < parent_.size()) {
+    if (until_clock_check-- == 0) {
+      if (std::chrono::steady_clock::now() >= deadline) {
+        return Result::kTimeLimit;
+      }
+      until_clock_check = kCosetsBetweenClockChecks;
+    }
+
+    auto c = static_cast<Coset>(current_);
+    bool has_room = true;
+    for (auto&& w : relators_) {
+      if (!IsLive(c)) {
+        break;
+      }
+      has_room = ScanAndFill(c, w);
+      if (!has_room) {
+        break;
+      }
+    }
+
+    for (Word::Letter l = 0; has_room && IsLive(c) && l.AsInt() < kLabels; ++l) {
+      if (Entry(c, l) == kNone) {
+        has_room = Define(c, l);
+      }
+    }
+
+    if (!has_room) {
+      if (!Lookahead()) {
+        return Result::kMemoryLimit;
+      }
+      //the current coset is processed again from the beginning
+      continue;
+    }
+
+    ProcessDeductions();
+    ++current_;
+  }
+
+  return Result::kComplete;
+}
+
+}
@@ -0,0 +1,110 @@
+#ifndef ACC_TODD_COXETER_H
+#define ACC_TODD_COXETER_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include <compressed_word/tuple_normal_form.h>
+
+namespace crag {
+
+//! Todd-Coxeter enumeration of the elements of a two-generator group <x, y | u, v>
+/**
+ * Uses the HLT strategy: relators are scanned at every coset in turn, and the missing cosets are defined on the way.
+ * Every definition and deduction is pushed to a (bounded) deduction stack, which is processed after every coset as in
+ * the Felsch strategy, so that coincidences are found earlier and the table stays small.
+ *
+ * When the table reaches the coset limit, the lookahead is performed: all relators are scanned at all cosets without
+ * defining new ones and the table is compacted. If that doesn't free any space, the enumeration fails.
+ */
+class ToddCoxeter {
+ public:
+  using Word = CWord;
+  using Coset = uint32_t;
+
+  enum class Result {
+    kComplete,     //!< Coset table is complete, size() is the order of the group
+    kMemoryLimit,  //!< Table didn't fit into the coset limit even after lookahead
+    kTimeLimit,    //!< The time budget is exhausted
+  };
+
+  static constexpr size_t kDefaultCosetsLimit = (1u << 20);
+
+  //! Prepares the enumeration, relators are cyclically reduced and the empty ones are ignored
+  explicit ToddCoxeter(const CWordTuple<2>& relators, size_t cosets_limit = kDefaultCosetsLimit);
+
+  //! Runs or continues the enumeration for at most @p time_budget
+  Result Enumerate(std::chrono::steady_clock::duration time_budget);
+
+  //! Number of the live cosets
+  size_t size() const {
+    return live_cosets_;
+  }
+
+  //! Number of cosets which were defined during the enumeration, including the ones which were merged later
+  size_t defined_cosets() const {
+    return defined_cosets_;
+  }
+
+ private:
+  static constexpr Coset kNone = static_cast<Coset>(-1);
+  static constexpr size_t kLabels = 2 * Word::kAlphabetSize;
+  static constexpr size_t kMaxDeductions = (1u << 12);
+  static constexpr size_t kInitialCapacity = 64; //!< Most of presentations of the trivial group need less cosets
+
+  struct Deduction {
+    Coset coset;
+    Word::Letter label;
+  };
+
+  std::vector<Word> relators_;
+  std::array<std::vector<Word>, kLabels> conjugates_; //!< All cyclic permutations of relators and their inverses
+  size_t cosets_limit_;
+
+  std::vector<Coset> table_; //!< table_[kLabels * c + l] is c^l, or kNone
+  std::vector<Coset> parent_; //!< Disjoint subsets of the coincident cosets, parent_[c] == c for the live ones
+  std::vector<Coset> coincidences_; //!< Queue of the dead cosets which rows are yet to be merged
+  std::vector<Deduction> deductions_;
+  size_t live_cosets_ = 0;
+  size_t defined_cosets_ = 0;
+  size_t current_ = 0; //!< HLT position, all cosets before it have complete rows and all relators scanned
+
+  Coset& Entry(Coset c, Word::Letter l) {
+    return table_[kLabels * c + l.AsInt()];
+  }
+
+  bool IsLive(Coset c) const {
+    return parent_[c] == c;
+  }
+
+  Coset Find(Coset c);
+
+  //! Defines c^l as a new coset, returns false if there is no room
+  bool Define(Coset c, Word::Letter l);
+
+  //! Sets c^l = d and d^{l^-1} = c
+  void Deduce(Coset c, Word::Letter l, Coset d);
+
+  //! Makes c and d the same coset and processes all consequences
+  void Coincidence(Coset c, Coset d);
+  void Merge(Coset c, Coset d);
+
+  //! Scans @p w at @p c, returns false if it needs to define a coset but there is no room
+  bool ScanAndFill(Coset c, Word w);
+
+  //! Scans @p w at @p c without defining new cosets
+  void Scan(Coset c, Word w);
+
+  void ProcessDeductions();
+
+  //! Scans all relators at all cosets without defining new ones and compacts the table. Returns if anything was freed
+  bool Lookahead();
+
+  void Compact();
+};
+
+}
+
+#endif //ACC_TODD_COXETER_H
@@ -0,0 +1,395 @@
+#ifndef ACC_DISJOINT_SETS_H
+#define ACC_DISJOINT_SETS_H
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace crag {
+
+//! Disjoint-set forest over the indices 0, ..., size() - 1
+/**
+ * Subsets are merged by size and Find() performs path halving, so any sequence of operations takes almost linear time.
+ * Find() of a const forest doesn't modify anything, so a forest may be shared between readers.
+ *
+ * @p Storage is a random access container of Index, like a vector. Nothing is written through its non-const access
+ * unless the forest is really changed, so copy-on-write containers don't make copies on the reads.
+ *
+ * With @p Concurrent set, all operations may be called from different threads at once, see the specialization below.
+ */
+template <typename Index = uint32_t, bool Concurrent = false, typename Storage = std::vector<Index>>
+class DisjointSets {
+  static_assert(!Concurrent, "Concurrent mode packs a parent and a size into 64 bits, so it requires uint32_t indices");
+
+ public:
+  using index_type = Index;
+
+  DisjointSets() = default;
+
+  //! @p count singletons
+  explicit DisjointSets(size_t count) {
+    Resize(count);
+  }
+
+  size_t size() const {
+    return parent_.size();
+  }
+
+  void reserve(size_t count) {
+    parent_.reserve(count);
+    size_.reserve(count);
+  }
+
+  //! Adds singletons up to @p count elements
+  void Resize(size_t count) {
+    assert(count >= size());
+    auto old_size = size();
+    parent_.resize(count);
+    size_.resize(count, 1);
+    for (auto x = old_size; x < count; ++x) {
+      parent_[x] = static_cast<Index>(x);
+    }
+  }
+
+  //! Adds a new singleton and returns its index
+  Index Add() {
+    auto index = static_cast<Index>(size());
+    parent_.push_back(index);
+    size_.push_back(1);
+    return index;
+  }
+
+  //! The parent of @p x in the forest, which is @p x itself for the roots
+  Index ParentOf(Index x) const {
+    return static_cast<const Storage&>(parent_)[x];
+  }
+
+  bool IsRoot(Index x) const {
+    return ParentOf(x) == x;
+  }
+
+  //! Root of the subset of @p x, the path to it is halved
+  Index Find(Index x) {
+    return Find(x, [](Index, Index) {});
+  }
+
+  //! Same as Find(x), @p visit(y, parent) is called for every y on the path before y is relinked to the parent of parent
+  /**
+   * This makes it possible to keep some data on the links, like the weights of the paths to the root
+   */
+  template <typename Visitor>
+  Index Find(Index x, Visitor&& visit) {
+    assert(x < size());
+    while (ParentOf(x) != x) {
+      auto parent = ParentOf(x);
+      visit(x, parent);
+      if (ParentOf(parent) != parent) {
+        parent_[x] = ParentOf(parent);
+      }
+      x = ParentOf(parent);
+    }
+    return x;
+  }
+
+  //! Root of the subset of @p x, nothing is modified
+  Index Find(Index x) const {
+    assert(x < size());
+    while (ParentOf(x) != x) {
+      x = ParentOf(x);
+    }
+    return x;
+  }
+
+  bool SameSubset(Index x, Index y) {
+    return Find(x) == Find(y);
+  }
+
+  bool SameSubset(Index x, Index y) const {
+    return Find(x) == Find(y);
+  }
+
+  size_t SubsetSize(Index x) const {
+    return static_cast<const Storage&>(size_)[Find(x)];
+  }
+
+  //! Merges the subsets of @p x and @p y and returns the new root
+  /**
+   * The root of the larger subset becomes the root, on ties it is the root of @p x
+   */
+  Index Merge(Index x, Index y) {
+    x = Find(x);
+    y = Find(y);
+    if (x == y) {
+      return x;
+    }
+    if (SubsetSize(x) < SubsetSize(y)) {
+      std::swap(x, y);
+    }
+    Link(y, x);
+    return x;
+  }
+
+  //! Makes the root @p root the parent of the root @p child regardless of the sizes
+  /**
+   * For the callers which need a particular element of a subset to be its root, e.g. the least one
+   */
+  void Link(Index child, Index root) {
+    assert(IsRoot(child) && IsRoot(root) && child != root);
+    size_[root] += SubsetSize(child);
+    parent_[child] = root;
+  }
+
+  //! Links every element directly to its root
+  void Flatten() {
+    for (Index x = 0; x < size(); ++x) {
+      auto root = Find(x);
+      if (ParentOf(x) != root) {
+        parent_[x] = root;
+      }
+    }
+  }
+
+ private:
+  Storage parent_;
+  Storage size_; //!< Valid only for the roots
+};
+
+//! Lock-free disjoint-set forest of a fixed size
+/**
+ * The parent and the size of every element are packed into a single atomic word, so linking a root is a single CAS
+ * which fails if the root got a parent or grew in between. The sizes only grow, so two threads can't link two roots
+ * to each other. The size of the linked subset is then added to the current root of the new parent, hence the sizes
+ * are exact as soon as all merges are finished. Path halving is done with a CAS as well, so Find() modifies the forest
+ * even if it is const. @p Storage is not used, the words are always kept in a vector.
+ */
+template <typename Storage>
+class DisjointSets<uint32_t, true, Storage> {
+ public:
+  using index_type = uint32_t;
+  using Index = uint32_t;
+
+  DisjointSets() = default;
+
+  explicit DisjointSets(size_t count)
+      : words_(count) {
+    for (Index x = 0; x < count; ++x) {
+      words_[x].store(Pack(x, 1), std::memory_order_relaxed);
+    }
+  }
+
+  //! Copies a snapshot, it is consistent only if there are no concurrent merges
+  DisjointSets(const DisjointSets& other)
+      : words_(other.size()) {
+    for (size_t x = 0; x < size(); ++x) {
+      words_[x].store(other.words_[x].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+  }
+
+  DisjointSets& operator=(const DisjointSets& other) {
+    if (this != &other) {
+      words_ = std::vector<std::atomic<uint64_t>>(other.size());
+      for (size_t x = 0; x < size(); ++x) {
+        words_[x].store(other.words_[x].load(std::memory_order_relaxed), std::memory_order_relaxed);
+      }
+    }
+    return *this;
+  }
+
+  size_t size() const {
+    return words_.size();
+  }
+
+  bool IsRoot(Index x) const {
+    return ParentOf(words_[x].load(std::memory_order_acquire)) == x;
+  }
+
+  Index Find(Index x) const {
+    assert(x < size());
+    while (true) {
+      auto word = words_[x].load(std::memory_order_acquire);
+      auto parent = ParentOf(word);
+      if (parent == x) {
+        return x;
+      }
+      auto grand_parent = ParentOf(words_[parent].load(std::memory_order_acquire));
+      if (grand_parent != parent) {
+        //if this fails, someone else has already moved x up
+        words_[x].compare_exchange_weak(word, Pack(grand_parent, SizeOf(word)), std::memory_order_release,
+                                        std::memory_order_relaxed);
+      }
+      x = grand_parent;
+    }
+  }
+
+  //! Checks if @p x and @p y are in the same subset at some moment during the call
+  bool SameSubset(Index x, Index y) const {
+    while (true) {
+      x = Find(x);
+      y = Find(y);
+      if (x == y) {
+        return true;
+      }
+      //if x is still a root, then y wasn't in its subset when it was found
+      if (IsRoot(x)) {
+        return false;
+      }
+    }
+  }
+
+  //! Size of the subset, exact if there are no concurrent merges
+  size_t SubsetSize(Index x) const {
+    return SizeOf(words_[Find(x)].load(std::memory_order_acquire));
+  }
+
+  //! Merges the subsets of @p x and @p y and returns the root which got the other one as a child
+  /**
+   * The root of the larger subset becomes the parent, on ties the lesser index does
+   */
+  Index Merge(Index x, Index y) {
+    while (true) {
+      x = Find(x);
+      y = Find(y);
+      if (x == y) {
+        return x;
+      }
+      auto x_word = words_[x].load(std::memory_order_acquire);
+      auto y_word = words_[y].load(std::memory_order_acquire);
+      if (ParentOf(x_word) != x || ParentOf(y_word) != y) {
+        continue;
+      }
+      if (SizeOf(x_word) < SizeOf(y_word) || (SizeOf(x_word) == SizeOf(y_word) && y < x)) {
+        std::swap(x, y);
+        std::swap(x_word, y_word);
+      }
+      if (!words_[y].compare_exchange_strong(y_word, Pack(x, SizeOf(y_word)), std::memory_order_acq_rel)) {
+        continue;
+      }
+      AddSize(x, SizeOf(y_word));
+      return x;
+    }
+  }
+
+ private:
+  mutable std::vector<std::atomic<uint64_t>> words_; //!< Find() of a const forest does path halving as well
+
+  static uint64_t Pack(Index parent, uint64_t size) {
+    return (size << 32u) | parent;
+  }
+
+  static Index ParentOf(uint64_t word) {
+    return static_cast<Index>(word);
+  }
+
+  static size_t SizeOf(uint64_t word) {
+    return static_cast<size_t>(word >> 32u);
+  }
+
+  //! Adds @p size to the current root of @p x
+  void AddSize(Index x, size_t size) {
+    while (true) {
+      x = Find(x);
+      auto word = words_[x].load(std::memory_order_acquire);
+      if (ParentOf(word) == x
+          && words_[x].compare_exchange_weak(word, Pack(x, SizeOf(word) + size), std::memory_order_acq_rel)) {
+        return;
+      }
+    }
+  }
+};
+
+//! Disjoint-set forest which keeps only the parents, the least element of every subset is its root
+/**
+ * Takes half of the memory of DisjointSets, which matters for the forests over all words of some lengths. Linking by
+ * index together with path halving still makes Find() logarithmic on average.
+ */
+template <typename Index = uint32_t, typename Storage = std::vector<Index>>
+class LeastRootDisjointSets {
+ public:
+  using index_type = Index;
+
+  LeastRootDisjointSets() = default;
+
+  //! @p count singletons
+  explicit LeastRootDisjointSets(size_t count) {
+    Resize(count);
+  }
+
+  size_t size() const {
+    return parent_.size();
+  }
+
+  //! Adds singletons up to @p count elements
+  void Resize(size_t count) {
+    assert(count >= size());
+    auto old_size = size();
+    parent_.resize(count);
+    for (auto x = old_size; x < count; ++x) {
+      parent_[x] = static_cast<Index>(x);
+    }
+  }
+
+  //! The parent of @p x in the forest, which is @p x itself for the roots
+  Index ParentOf(Index x) const {
+    return static_cast<const Storage&>(parent_)[x];
+  }
+
+  bool IsRoot(Index x) const {
+    return ParentOf(x) == x;
+  }
+
+  //! Root of the subset of @p x, the path to it is halved
+  Index Find(Index x) {
+    assert(x < size());
+    while (ParentOf(x) != x) {
+      auto grand_parent = ParentOf(ParentOf(x));
+      if (grand_parent != ParentOf(x)) {
+        parent_[x] = grand_parent;
+      }
+      x = grand_parent;
+    }
+    return x;
+  }
+
+  //! Root of the subset of @p x, nothing is modified
+  Index Find(Index x) const {
+    assert(x < size());
+    while (ParentOf(x) != x) {
+      x = ParentOf(x);
+    }
+    return x;
+  }
+
+  //! Merges the subsets of @p x and @p y and returns the new root, which is the least of the two roots
+  Index Merge(Index x, Index y) {
+    x = Find(x);
+    y = Find(y);
+    if (y < x) {
+      std::swap(x, y);
+    }
+    if (x != y) {
+      parent_[y] = x;
+    }
+    return x;
+  }
+
+  //! Links every element directly to its root
+  void Flatten() {
+    // the parents are less than the children, so the parent of x is already linked to its root
+    for (Index x = 0; x < size(); ++x) {
+      auto root = ParentOf(ParentOf(x));
+      if (ParentOf(x) != root) {
+        parent_[x] = root;
+      }
+    }
+  }
+
+ private:
+  Storage parent_;
+};
+
+} //crag
+
+#endif //ACC_DISJOINT_SETS_H
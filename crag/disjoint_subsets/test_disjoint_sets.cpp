@@ -0,0 +1,169 @@
+#include <random>
+#include <thread>
+
+#include "disjoint_sets.h"
+#include "gtest/gtest.h"
+
+namespace crag {
+namespace {
+
+TEST(DisjointSets, Singletons) {
+  DisjointSets<> sets(4);
+
+  EXPECT_EQ(4u, sets.size());
+  for (uint32_t x = 0; x < 4; ++x) {
+    EXPECT_TRUE(sets.IsRoot(x));
+    EXPECT_EQ(x, sets.Find(x));
+    EXPECT_EQ(1u, sets.SubsetSize(x));
+  }
+  EXPECT_FALSE(sets.SameSubset(0, 1));
+
+  EXPECT_EQ(4u, sets.Add());
+  EXPECT_EQ(5u, sets.size());
+}
+
+TEST(DisjointSets, MergeBySize) {
+  DisjointSets<> sets(4);
+
+  EXPECT_EQ(0u, sets.Merge(0, 1));
+  EXPECT_EQ(0u, sets.Merge(2, 0));
+  EXPECT_EQ(3u, sets.SubsetSize(2));
+  EXPECT_EQ(3u, sets.Merge(3, 3));
+  EXPECT_EQ(0u, sets.Merge(3, 1));
+
+  EXPECT_EQ(4u, sets.SubsetSize(3));
+  for (uint32_t x = 0; x < 4; ++x) {
+    EXPECT_EQ(0u, sets.Find(x));
+  }
+  EXPECT_EQ(0u, sets.Merge(1, 2));
+}
+
+TEST(DisjointSets, Link) {
+  DisjointSets<size_t> sets(3);
+
+  sets.Link(0, 1);
+  sets.Link(1, 2);
+
+  const auto& const_sets = sets;
+  EXPECT_EQ(2u, const_sets.Find(0));
+  EXPECT_FALSE(const_sets.IsRoot(1));
+  EXPECT_EQ(3u, const_sets.SubsetSize(0));
+}
+
+TEST(DisjointSets, LongChain) {
+  const uint32_t kCount = 1000;
+  DisjointSets<> sets(kCount);
+  for (uint32_t x = 1; x < kCount; ++x) {
+    sets.Link(x - 1, x);
+  }
+
+  EXPECT_EQ(kCount - 1, sets.Find(0));
+  EXPECT_TRUE(sets.SameSubset(0, kCount / 2));
+
+  sets.Flatten();
+  for (uint32_t x = 0; x < kCount; ++x) {
+    const auto& const_sets = sets;
+    EXPECT_EQ(kCount - 1, const_sets.Find(x));
+  }
+}
+
+TEST(DisjointSets, FindVisitor) {
+  //weight of every element is the sum of weights of the links to the root
+  DisjointSets<> sets(4);
+  std::vector<int> weights = {1, 2, 4, 0};
+  sets.Link(0, 1);
+  sets.Link(1, 2);
+  sets.Link(2, 3);
+
+  int weight = 0;
+  EXPECT_EQ(3u, sets.Find(0, [&](uint32_t x, uint32_t parent) {
+    weights[x] += weights[parent];
+    weight += weights[x];
+  }));
+  EXPECT_EQ(7, weight);
+  EXPECT_EQ(3, weights[0]);
+  EXPECT_EQ(7, weights[0] + weights[2]);
+}
+
+TEST(DisjointSets, ConcurrentMatchesSequential) {
+  const uint32_t kCount = 1u << 14;
+  const auto kThreads = 4u;
+  std::mt19937 engine;
+  std::uniform_int_distribution<uint32_t> element(0, kCount - 1);
+
+  std::vector<std::pair<uint32_t, uint32_t>> merges(kCount / 2);
+  for (auto&& merge : merges) {
+    merge = std::make_pair(element(engine), element(engine));
+  }
+
+  DisjointSets<> sequential(kCount);
+  for (auto&& merge : merges) {
+    sequential.Merge(merge.first, merge.second);
+  }
+
+  DisjointSets<uint32_t, true> concurrent(kCount);
+  std::vector<std::thread> threads;
+  for (auto thread = 0u; thread < kThreads; ++thread) {
+    threads.emplace_back([&, thread] {
+      for (auto i = thread; i < merges.size(); i += kThreads) {
+        concurrent.Merge(merges[i].first, merges[i].second);
+        EXPECT_TRUE(concurrent.SameSubset(merges[i].first, merges[i].second));
+      }
+    });
+  }
+  for (auto&& thread : threads) {
+    thread.join();
+  }
+
+  auto copy = concurrent;
+  for (uint32_t x = 0; x < kCount; ++x) {
+    auto y = element(engine);
+    EXPECT_EQ(sequential.SameSubset(x, y), copy.SameSubset(x, y));
+    EXPECT_EQ(sequential.SubsetSize(x), copy.SubsetSize(x));
+  }
+}
+
+TEST(LeastRootDisjointSets, MergeByIndex) {
+  LeastRootDisjointSets<> sets(5);
+
+  EXPECT_EQ(3u, sets.Merge(4, 3));
+  EXPECT_EQ(1u, sets.Merge(3, 1));
+  EXPECT_EQ(1u, sets.Merge(4, 4));
+  EXPECT_EQ(0u, sets.Merge(4, 0));
+  EXPECT_EQ(0u, sets.Merge(1, 3));
+
+  EXPECT_TRUE(sets.IsRoot(0));
+  EXPECT_TRUE(sets.IsRoot(2));
+  for (uint32_t x : {0u, 1u, 3u, 4u}) {
+    EXPECT_EQ(0u, sets.Find(x));
+  }
+  EXPECT_EQ(2u, sets.Find(2));
+}
+
+TEST(LeastRootDisjointSets, MatchesDisjointSets) {
+  const uint32_t kCount = 2000;
+  std::mt19937 engine(5);
+  std::uniform_int_distribution<uint32_t> element(0, kCount - 1);
+
+  DisjointSets<> sets(kCount);
+  LeastRootDisjointSets<> least_root(kCount);
+  for (auto i = 0u; i < kCount; ++i) {
+    auto x = element(engine);
+    auto y = element(engine);
+    sets.Merge(x, y);
+    least_root.Merge(x, y);
+  }
+  least_root.Flatten();
+
+  std::vector<uint32_t> least(kCount, kCount);
+  for (uint32_t x = 0; x < kCount; ++x) {
+    least[sets.Find(x)] = std::min(least[sets.Find(x)], x);
+  }
+  for (uint32_t x = 0; x < kCount; ++x) {
+    ASSERT_EQ(least[sets.Find(x)], least_root.ParentOf(x));
+    ASSERT_EQ(x == least_root.ParentOf(x), least_root.IsRoot(x));
+  }
+}
+
+} //namespace
+} //namespace crag
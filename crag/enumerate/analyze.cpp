@@ -3,9 +3,15 @@
 //
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
-#include <deque>
+#include <cstdlib>
 #include <fstream>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <vector>
 
 #include <boost/variant.hpp>
 
@@ -17,14 +23,27 @@
 
 using namespace crag;
 
-std::vector<Endomorphism> GenAllEndomorphisms(CWord::size_type max_image_length) {
-  std::vector<Endomorphism> result;
+//! Endomorphism with the exponent sums of the images of x and y
+struct EndomorphismInfo {
+  Endomorphism endomorphism;
+  std::array<int, CWord::kAlphabetSize> x_image_sums;
+  std::array<int, CWord::kAlphabetSize> y_image_sums;
+
+  //! Length of the image of a word with exponent sums @p sums is at least the sum of the absolute values of its sums
+  int ImageLengthLowerBound(const std::array<int, CWord::kAlphabetSize>& sums) const {
+    return std::abs(sums[0] * x_image_sums[0] + sums[1] * y_image_sums[0])
+        + std::abs(sums[0] * x_image_sums[1] + sums[1] * y_image_sums[1]);
+  }
+};
+
+std::vector<EndomorphismInfo> GenAllEndomorphisms(CWord::size_type max_image_length) {
+  std::vector<EndomorphismInfo> result;
   for(CWord::size_type total_length = 2; total_length <= 2*max_image_length; ++total_length) {
     for(CWord::size_type x_image_length = 1; x_image_length + 1 < total_length; ++x_image_length) {
       for (auto&& x_image : EnumerateWords(x_image_length)) {
         auto y_image_length = static_cast<CWord::size_type>(total_length - x_image_length);
         for (auto&& y_image : EnumerateWords(y_image_length)) {
-          result.emplace_back(Endomorphism(x_image, y_image));
+          result.push_back(EndomorphismInfo{Endomorphism(x_image, y_image), x_image.ExponentSums(), y_image.ExponentSums()});
         }
       }
     }
@@ -155,11 +174,8 @@ int main() {
   std::vector<CanonicalType> canonical_types_;
 
   std::ofstream result("roots.txt");
-  for (auto&& word : mapping.mapping()) {
-    if (word.root_ != nullptr) {
-      continue;
-    }
-    canonical_types_.emplace_back(CanonicalType{word.canonical_word_, word.set_size_});
+  for (auto&& canonical_class : mapping.Classes()) {
+    canonical_types_.emplace_back(CanonicalType{canonical_class.canonical_word_, canonical_class.size_});
   }
 
   std::sort(canonical_types_.begin(), canonical_types_.end(), [](
@@ -192,18 +208,23 @@ int main() {
   }
 
   //now list all images of y^(-1) x^n y x^(-m)
-  std::deque<std::pair<CWord, BSType>> images_;
+  std::vector<std::pair<CWord, BSType>> frontier;
 
-  auto setBSType = [&](const CWord& bs_word, BSType bs_type) {
-    auto canonical_image = mapping.GetCanonical(bs_word);
+  auto findType = [&](const CWord& canonical_image) {
     auto image_type = std::lower_bound(canonical_types_.begin(), canonical_types_.end(), canonical_image,
         [](auto& type, auto& word) { return type.root_ < word; });
 
     assert(image_type != canonical_types_.end() && image_type->root_ == canonical_image);
+    return image_type;
+  };
+
+  auto setBSType = [&](const CWord& bs_word, BSType bs_type) {
+    auto canonical_image = mapping.GetCanonical(bs_word);
+    auto image_type = findType(canonical_image);
 
     if (boost::get<UnknownType>(&image_type->type_)) {
       image_type->type_ = bs_type;
-      images_.emplace_back(canonical_image, bs_type);
+      frontier.emplace_back(canonical_image, bs_type);
       return true;
     } else {
       return false;
@@ -227,31 +248,88 @@ int main() {
     }
   }
 
-  auto processed_count = 0u;
+  //The search goes in rounds over the whole frontier. Every class gets the type of the first word and endomorphism
+  //which hit it, in the order in which the sequential search would apply them, so the result is the same for any
+  //number of threads.
+  const auto workers_count = std::max(1u, std::thread::hardware_concurrency());
+  const auto kNotHit = std::numeric_limits<uint64_t>::max();
+  std::unique_ptr<std::atomic<uint64_t>[]> first_hit(new std::atomic<uint64_t>[canonical_types_.size()]);
+  for (size_t i = 0; i < canonical_types_.size(); ++i) {
+    first_hit[i].store(kNotHit, std::memory_order_relaxed);
+  }
 
-  while (!images_.empty()) {
-    auto the_word = images_.front().first;
-    auto the_type = images_.front().second;
-    images_.pop_front();
-
-    ++processed_count;
-    std::cout << processed_count << "/" << processed_count + images_.size() << ": ";
-    auto images_start = std::chrono::steady_clock::now();
-    PrintWord(the_word, &std::cout);
-    std::cout.flush();
-    assert(the_word.size() <= max_length);
-
-    for (auto&& end : all_endomorphisms) {
-      try {
-        auto image = end.Apply(the_word);
-        if (image.size() > max_length || image.size() < 1) {
-          continue;
+  auto processed_count = 0u;
+  while (!frontier.empty()) {
+    auto round_start = std::chrono::steady_clock::now();
+    std::atomic<size_t> next_word{0u};
+    std::vector<std::vector<size_t>> hit_types(workers_count);
+
+    auto processWords = [&](std::vector<size_t>* hit) {
+      for (auto word_id = next_word++; word_id < frontier.size(); word_id = next_word++) {
+        const auto& the_word = frontier[word_id].first;
+        assert(the_word.size() <= max_length);
+        const auto sums = the_word.ExponentSums();
+
+        for (size_t end_id = 0; end_id < all_endomorphisms.size(); ++end_id) {
+          const auto& end = all_endomorphisms[end_id];
+          if (end.ImageLengthLowerBound(sums) > max_length) {
+            continue;
+          }
+          try {
+            auto image = end.endomorphism.Apply(the_word);
+            if (image.size() > max_length || image.size() < 1) {
+              continue;
+            }
+
+            //types are changed only between the rounds
+            auto type_id = static_cast<size_t>(findType(mapping.GetCanonical(image)) - canonical_types_.begin());
+            if (!boost::get<UnknownType>(&canonical_types_[type_id].type_)) {
+              continue;
+            }
+
+            auto order = word_id * all_endomorphisms.size() + end_id;
+            auto current = first_hit[type_id].load(std::memory_order_relaxed);
+            while (order < current) {
+              if (first_hit[type_id].compare_exchange_weak(current, order, std::memory_order_relaxed)) {
+                hit->push_back(type_id);
+                break;
+              }
+            }
+          } catch (const std::length_error&) { /*do nothing*/ }
         }
+      }
+    };
+
+    std::vector<std::thread> workers;
+    for (auto&& hit : hit_types) {
+      workers.emplace_back(processWords, &hit);
+    }
+    for (auto&& worker : workers) {
+      worker.join();
+    }
 
-        setBSType(image, the_type);
-      } catch (const std::length_error&) { /*do nothing*/ }
+    std::vector<std::pair<uint64_t, size_t>> hits;
+    for (auto&& hit : hit_types) {
+      for (auto&& type_id : hit) {
+        hits.emplace_back(first_hit[type_id].load(std::memory_order_relaxed), type_id);
+      }
     }
-    std::cout << std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - images_start).count() << std::endl;
+    std::sort(hits.begin(), hits.end());
+    hits.erase(std::unique(hits.begin(), hits.end()), hits.end());
+
+    std::vector<std::pair<CWord, BSType>> next_frontier;
+    for (auto&& hit : hits) {
+      auto& canonical = canonical_types_[hit.second];
+      auto the_type = frontier[hit.first / all_endomorphisms.size()].second;
+      canonical.type_ = the_type;
+      next_frontier.emplace_back(canonical.root_, the_type);
+    }
+
+    processed_count += frontier.size();
+    std::cout << processed_count << "/" << processed_count + next_frontier.size() << ": "
+        << std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - round_start).count()
+        << std::endl;
+    frontier = std::move(next_frontier);
   }
 
   for (auto&& canonical : canonical_types_) {
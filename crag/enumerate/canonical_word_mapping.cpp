@@ -3,6 +3,8 @@
 //
 
 #include <algorithm>
+#include <limits>
+#include <stdexcept>
 
 #include <compressed_word/enumerate_words.h>
 
@@ -30,55 +32,79 @@ CWord MakeLess(CWord w) {
   return AutomorphicReduction(w);
 }
 
-void CanonicalMapping::CanonicalWord::Merge(CanonicalWord* other) {
-  auto this_root = root();
-  auto other_root = other->root();
-  assert(this_root->root_ == nullptr);
-  assert(other_root->root_ == nullptr);
-  if (this_root != other_root) {
-    if (this_root->set_size_ < other_root->set_size_) {
-      //other_root becomes the new root
-      this_root->root_ = other_root;
-      other_root->set_size_ += this_root->set_size_;
-      if (this_root->canonical_word_ < other_root->canonical_word_) {
-        other_root->canonical_word_ = this_root->canonical_word_;
-      }
-    } else {
-      other_root->root_ = this_root;
-      this_root->set_size_ += other_root->set_size_;
-      if (other_root->canonical_word_ < this_root->canonical_word_) {
-        this_root->canonical_word_ = other_root->canonical_word_;
-      }
-    }
+CanonicalMapping::Index CanonicalMapping::IndexOf(const CWord& w) const {
+  if (w.size() < min_length_ || w.size() >= end_length_) {
+    throw std::out_of_range("Can't find the word");
   }
+  return static_cast<Index>(offsets_[w.size() - min_length_] + w.Rank());
+}
+
+CWord CanonicalMapping::WordAt(Index index) const {
+  auto length = std::upper_bound(offsets_.begin(), offsets_.end(), index) - offsets_.begin() - 1;
+  return CWord::Unrank(static_cast<CWord::size_type>(min_length_ + length), index - offsets_[length]);
 }
 
-CanonicalMapping::CanonicalMapping(CWord::size_type min_length, CWord::size_type end_length) {
+CanonicalMapping::CanonicalMapping(CWord::size_type min_length, CWord::size_type end_length)
+    : min_length_(min_length)
+    , end_length_(end_length) {
+  uint64_t count = 0;
+  for (auto length = min_length; length < end_length; ++length) {
+    offsets_.push_back(count);
+    count += CWord::ReducedCount(length);
+  }
+  if (count > std::numeric_limits<Index>::max()) {
+    throw std::length_error("Too many words for CanonicalMapping");
+  }
+  is_cyclic_reduced_.assign(count, false);
+  classes_.Resize(count);
+
   for (auto&& word : EnumerateWords::CyclicReduced(min_length, end_length)) {
-    mapping_.emplace_back(word);
+    auto index = IndexOf(word);
+    is_cyclic_reduced_[index] = true;
     auto reduced_word = MakeLess(word);
     if (reduced_word != word) {
-      auto root = std::lower_bound(mapping_.begin(), mapping_.end(), reduced_word,
-          [](const CanonicalWord& lhs, const CWord& rhs) { return lhs.word_ < rhs; });
-
-      if(root == mapping_.end() || root->word_ != reduced_word) {
+      if (reduced_word.size() < min_length_ || !is_cyclic_reduced_[IndexOf(reduced_word)]) {
         throw std::runtime_error("Image not found");
       }
 
-      mapping_.back().Merge(&*root);
+      classes_.Merge(index, IndexOf(reduced_word));
     }
   }
-}
 
-const CWord& CanonicalMapping::GetCanonical(const CWord& word) const {
-  auto pos = std::lower_bound(mapping_.begin(), mapping_.end(), word,
-      [](const CanonicalWord& lhs, const CWord& rhs) { return lhs.word_ < rhs; });
+  //so that GetCanonical() is a single lookup
+  classes_.Flatten();
+}
 
-  if (pos == mapping_.end() || pos->word_ != word) {
+CWord CanonicalMapping::GetCanonical(const CWord& word) const {
+  auto index = IndexOf(word);
+  if (!is_cyclic_reduced_[index]) {
     throw std::out_of_range("Can't find the word");
   }
-  return pos->root()->canonical_word_;
+  return WordAt(classes_.Find(index));
 }
 
-} //crag
+std::vector<CanonicalMapping::Class> CanonicalMapping::Classes() const {
+  std::vector<Index> roots;
+  for (Index index = 0; index < classes_.size(); ++index) {
+    if (is_cyclic_reduced_[index] && classes_.IsRoot(index)) {
+      roots.push_back(index);
+    }
+  }
 
+  //the forest is flat, so every word is a child of its root
+  std::vector<size_t> sizes(roots.size(), 0u);
+  for (Index index = 0; index < classes_.size(); ++index) {
+    if (is_cyclic_reduced_[index]) {
+      ++sizes[std::lower_bound(roots.begin(), roots.end(), classes_.ParentOf(index)) - roots.begin()];
+    }
+  }
+
+  std::vector<Class> classes;
+  classes.reserve(roots.size());
+  for (size_t i = 0; i < roots.size(); ++i) {
+    classes.push_back(Class{WordAt(roots[i]), sizes[i]});
+  }
+  return classes;
+}
+
+} //crag
@@ -5,56 +5,45 @@
 #ifndef ACC_CANONICAL_WORD_MAPPING_H
 #define ACC_CANONICAL_WORD_MAPPING_H
 
-#include <deque>
+#include <vector>
 
 #include <compressed_word/compressed_word.h>
+#include <crag/disjoint_subsets/disjoint_sets.h>
 
 namespace crag {
 
+//! Splits cyclically reduced words into classes of words which are mapped to each other by automorphisms
+/**
+ * Words are identified by the offset of their length plus CWord::Rank(), so the classes are disjoint subsets of
+ * indices. The root of every subset is its least index, that is the least word of the class.
+ */
 class CanonicalMapping {
+ public:
+  using Index = uint32_t;
 
-  struct CanonicalWord {
-    CWord word_;
+  struct Class {
     CWord canonical_word_;
-    CanonicalWord* root_ = nullptr;
-    size_t set_size_ = 1;
-
-    CanonicalWord* root() {
-      if (root_ == nullptr) {
-        return this;
-      }
-      root_ = root_->root();
-      return root_;
-    }
-
-    const CanonicalWord* root() const {
-      if (root_ == nullptr) {
-        return this;
-      }
-      return root_->root();
-    }
-
-    void Merge(CanonicalWord* other);
-
-    CanonicalWord(CWord word)
-      : word_(word)
-      , canonical_word_(word)
-    { }
+    size_t size_;
   };
- public:
+
   CanonicalMapping()=default;
 
   CanonicalMapping(CWord::size_type min_length, CWord::size_type end_length);
 
-  const CWord& GetCanonical(const CWord& w) const;
-
-  const auto& mapping() const {
-    return mapping_;
-  }
- private:
-  std::deque<CanonicalWord> mapping_;
+  CWord GetCanonical(const CWord& w) const;
 
+  //! All classes ordered by the canonical word
+  std::vector<Class> Classes() const;
 
+ private:
+  CWord::size_type min_length_ = 0;
+  CWord::size_type end_length_ = 0;
+  std::vector<uint64_t> offsets_; //!< offsets_[l - min_length_] is the index of the first word of length l
+  std::vector<bool> is_cyclic_reduced_;
+  LeastRootDisjointSets<Index> classes_;
+
+  Index IndexOf(const CWord& w) const;
+  CWord WordAt(Index index) const;
 };
 
 }
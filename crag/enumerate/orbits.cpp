@@ -11,26 +11,11 @@ using namespace crag;
 CWord conj(CWord u, CWord v) {
   return u.Inverse() + v.Inverse() + u + v;
 }
-int countX(CWord w) {
-  if (w.Empty()) {
-    return 0;
-  }
-  auto front = w.GetFront();
-  w.PopFront();
-  switch (front.AsInt()) {
-    case XYLetter('x').AsInt():
-      return 1 + countX(w);
-    case XYLetter('X').AsInt():
-      return -1 + countX(w);
-    default:
-      return countX(w);
-  }
-}
 
 CWord random_x0(std::random_device& rd) {
   RandomWord w(9, 9);
   auto result = w(rd);
-  while (countX(result) != 0) {
+  while (result.ExponentSums()[0] != 0) {
     result = w(rd);
   }
   return result;
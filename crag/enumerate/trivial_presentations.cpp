@@ -2,84 +2,27 @@
 // Created by dpantele on 2/15/16.
 //
 
-#include <compressed_word/enumerate_words.h>
+#include <compressed_word/enumerate_necklaces.h>
 #include <compressed_word/tuple_normal_form.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <fstream>
-#include <compressed_word/longest_common_subword_cyclic.h>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
 
-#include <folded_graph/complete.h>
-#include <folded_graph/folded_graph.h>
-#include <folded_graph/harvest.h>
+#include <coset_enumeration/todd_coxeter.h>
+#include <pair_filters/pair_filters.h>
 
 using namespace crag;
 
-std::pair<int, int> lettersPower(CWord w) {
-  auto x_power = 0;
-  auto y_power = 0;
-  while (!w.Empty()) {
-    switch (w.GetFront().AsChar()) {
-      case 'x':
-        x_power += 1;
-        break;
-      case 'X':
-        x_power -= 1;
-        break;
-      case 'y':
-        y_power += 1;
-        break;
-      case 'Y':
-        y_power -= 1;
-        break;
-      default:
-        assert(false);
-    }
-    w.PopFront();
-  }
-
-  return std::make_pair(x_power, y_power);
-}
-
-bool hasTrivialAbelianisation(const CWord& u, const CWord& v) {
-  auto u_powers = lettersPower(u);
-  auto v_powers = lettersPower(v);
-  return std::abs(u_powers.first * v_powers.second - v_powers.first * u_powers.second) == 1;
-}
-
-bool ConjugationLengthReduction(const CWord& u, const CWord& v) {
-  FoldedGraph g;
-  g.PushCycle(u, 1);
-  CompleteWith(v, &g);
-  CompleteWith(v, &g);
-  auto result = Harvest(u.size(), 1, &g);
-  if (result.empty()) {
-    return false;
-  }
-
-  for (auto&& u_p : result) {
-    if (u_p.size() > u.size()) {
-      break;
-    }
-    auto normal = ConjugationInverseNormalForm(u_p);
-    if (normal < u) {
-      return true;
-    }
-  }
-
-  return false;
-}
-
-bool HasRootCycle(const CWord& u, const FoldedGraph& g) {
-  auto u_path = g.ReadWord(u, g.root());
-  if (!u_path.unread_word_part().Empty()) {
-    return false;
-  }
-  return u_path.terminus() == g.root();
-}
-
 enum IsTrivialResult {
   kTrivial,
   kNonTrivial,
-  kUnknown
+  kUnknown,   //!< The enumeration didn't fit into kTrivialityCosetsLimit
+  kTimeLimit, //!< The enumeration hit kTrivialityTimeLimit, so the result depends on the machine
 };
 
 const char* IsTrivialToString(IsTrivialResult v) {
@@ -90,25 +33,29 @@ const char* IsTrivialToString(IsTrivialResult v) {
       return "NonTrivial";
     case kUnknown:
       return "Unknown";
+    case kTimeLimit:
+      return "TimeLimit";
   }
   assert(false);
 }
 
-bool isTrivial(const CWord& u, const CWord& v) {
-  FoldedGraph g;
-  bool is_complete = false;
-  for (auto i = 0u; i < 14 && !is_complete; ++i) {
-    auto size = g.size();
-    CompleteWith(u, size, &g);
-    CompleteWith(v, size, &g);
-    if (size == g.size()) {
-      is_complete = true;
-    }
-    if (i >= 6) {
-      std::cerr << "Takes too long for " << u << " " << v << "(" << i << ", " << size << "->" << g.size() << ")" << std::endl;
-    }
+//! Caps the enumeration deterministically, every pair of total length 14 takes less than 0.1s with it
+const size_t kTrivialityCosetsLimit = (1u << 16);
+//! Only a safety valve, the pairs which hit it are reported as undecided
+const auto kTrivialityTimeLimit = std::chrono::seconds(60);
+
+IsTrivialResult isTrivial(const CWord& u, const CWord& v, std::ostream* errors) {
+  ToddCoxeter enumeration(CWordTuple<2>{u, v}, kTrivialityCosetsLimit);
+  auto result = enumeration.Enumerate(kTrivialityTimeLimit);
+  if (result == ToddCoxeter::Result::kComplete) {
+    return enumeration.size() == 1 ? kTrivial : kNonTrivial;
+  }
+  if (result == ToddCoxeter::Result::kMemoryLimit) {
+    *errors << "Takes too long for " << u << " " << v << "(" << enumeration.defined_cosets() << " cosets)" << std::endl;
+    return kUnknown;
   }
-  return HasRootCycle(CWord("x"), g) && HasRootCycle(CWord("y"), g);
+  *errors << "Undecided " << u << " " << v << "(" << enumeration.defined_cosets() << " cosets)" << std::endl;
+  return kTimeLimit;
 }
 
 bool AllowAutoReduction(const CWord& u, const CWord& v) {
@@ -125,7 +72,7 @@ bool AllowAutoReduction(const CWord& u, const CWord& v) {
   return false;
 }
 
-void PrintAutoNormalForm(const CWord& u, const CWord& v) {
+void PrintAutoNormalForm(const CWord& u, const CWord& v, std::ostream* out) {
   auto tuple = CWordTuple<2>{u, v};
   auto min = tuple;
   for (auto&& image : ShortestAutomorphicImages(tuple)) {
@@ -139,70 +86,157 @@ void PrintAutoNormalForm(const CWord& u, const CWord& v) {
       min = image_min;
     }
   }
-  std::cout << min[0] << " " << min[1] << std::endl;
+  *out << min[0] << " " << min[1] << std::endl;
 }
 
-int main(int argc, char* argv[]) {
-  //we will consider words of type x..., y...
-  auto total_length = 14u;
-
-  std::ofstream trivial_abel("trivial_abel.txt");
-  std::ofstream no_simple_reduction("no_simple_reduction.txt");
-  std::ofstream no_conjugation_reduction("no_conjugation_reduction.txt");
-  std::ofstream trivial("trivial.txt");
+//! Everything which is found for a single u
+/**
+ * The pairs are numbered consecutively over all shards, so only the indices in trivial_abel are stored here and
+ * the numbers are assigned when the shards are written in order.
+ */
+struct Shard {
+  CWord u;
+  std::vector<CWord> trivial_abel;
+  std::vector<size_t> no_simple_reduction;
+  std::vector<size_t> no_conjugation_reduction;
+  std::vector<size_t> trivial;
+  std::vector<size_t> undecided; //!< Hit the time limit, so neither trivial nor listed as nontrivial
+  PairFilters filters;            //!< A copy of the common pipeline, its stats are merged after the shard is written
+  std::string out;
+  std::string errors;
+};
 
-  auto count = 0u;
+void ProcessShard(unsigned total_length, Shard* shard) {
+  const auto& u = shard->u;
+  std::ostringstream out;
+  std::ostringstream errors;
   auto count_nontrivial = 0u;
 
-  for(auto u : EnumerateWords(2, total_length - 1)) {
-    if (u.GetFront() == u.GetBack().Inverse()) {
+  auto v_length = static_cast<CWord::size_type>(total_length - u.size());
+  for (auto v : EnumerateNecklaces(v_length, ExponentSumsFilter::TrivialAbelianisation(u.ExponentSums(), v_length))) {
+    assert(HasTrivialAbelianisation(u, v));
+    if (v < u) {
       continue;
     }
-    if (ConjugationInverseNormalForm(u) != u) {
+
+    auto index = shard->trivial_abel.size();
+    shard->trivial_abel.push_back(v);
+
+    CWordTuple<2> reduced;
+    size_t filter;
+    if (shard->filters(CWordTuple<2>{u, v}, &reduced, &filter) != PairFilters::Verdict::kPass) {
+      if (shard->filters.stats()[filter].name == "conjugation_length") {
+        shard->no_simple_reduction.push_back(index);
+      }
       continue;
     }
-    for (auto v : EnumerateWords(total_length - u.size())) {
-      if (v.GetFront() == v.GetBack().Inverse()) {
-        continue;
-      }
-      if (ConjugationInverseNormalForm(v) != v) {
-        continue;
-      }
-      if (!hasTrivialAbelianisation(u, v)) {
-        continue;
-      }
-      if (v < u) {
-        continue;
-      }
 
-      ++count;
+    shard->no_simple_reduction.push_back(index);
 
-      trivial_abel << count << " " << u << " " << v << "\n";
+    shard->no_conjugation_reduction.push_back(index);
 
-      CWord::size_type common_part_length, common_u_begin, common_v_begin;
-      std::tie(common_u_begin, common_v_begin, common_part_length) = LongestCommonSubwordCyclic(u, v);
-      if (common_part_length > v.size() / 2 || common_part_length > u.size() / 2) {
-        continue;
-      }
+    auto is_trivial = isTrivial(u, v, &errors);
+    if (is_trivial == kTimeLimit) {
+      shard->undecided.push_back(index);
+      continue;
+    }
 
-      no_simple_reduction << count << " " << u << " " << v << "\n";
+    if (is_trivial != kTrivial) {
+      out << count_nontrivial << std::endl;
+      out << u << ' ' << v << std::endl;
+      out << AllowAutoReduction(u, v) << " ";
+      PrintAutoNormalForm(u, v, &out);
+      continue;
+    }
 
-      if (ConjugationLengthReduction(u, v) || ConjugationLengthReduction(v, u)) {
-        continue;
-      }
+    shard->trivial.push_back(index);
+  }
 
-      no_conjugation_reduction << count << " " << u << " " << v << "\n";
+  shard->out = out.str();
+  shard->errors = errors.str();
+}
+
+int main(int argc, char* argv[]) {
+  //we will consider words of type x..., y...
+  auto total_length = 14u;
+  auto workers_count = std::max<size_t>(1u, argc > 1 ? std::stoul(argv[1]) : std::thread::hardware_concurrency());
 
-      if (!isTrivial(u, v)) {
-        std::cout << count_nontrivial << std::endl;
-        std::cout << u << ' ' << v << std::endl;
-        std::cout << AllowAutoReduction(u, v) << " ";
-        PrintAutoNormalForm(u, v);
-        continue;
+  std::ofstream trivial_abel("trivial_abel.txt");
+  std::ofstream no_simple_reduction("no_simple_reduction.txt");
+  std::ofstream no_conjugation_reduction("no_conjugation_reduction.txt");
+  std::ofstream trivial("trivial.txt");
+  std::ofstream undecided("undecided.txt");
+
+  PairFilters filters;
+  AddTrivialPresentationFilters(&filters);
+
+  //every u is a shard, they are processed in parallel and written in the order of enumeration
+  std::vector<Shard> shards;
+  for (auto u : EnumerateNecklaces(2, total_length - 1)) {
+    shards.emplace_back();
+    shards.back().u = u;
+    shards.back().filters = filters;
+  }
+
+  std::mutex shards_mutex;
+  std::condition_variable shard_done;
+  std::vector<bool> is_done(shards.size(), false);
+  std::atomic<size_t> next_shard{0u};
+
+  std::vector<std::thread> workers;
+  while (workers.size() < workers_count) {
+    workers.emplace_back([&] {
+      for (auto i = next_shard++; i < shards.size(); i = next_shard++) {
+        ProcessShard(total_length, &shards[i]);
+        std::lock_guard<std::mutex> lock(shards_mutex);
+        is_done[i] = true;
+        shard_done.notify_all();
       }
+    });
+  }
+
+  auto count = 0u;
+  for (size_t i = 0; i < shards.size(); ++i) {
+    {
+      std::unique_lock<std::mutex> lock(shards_mutex);
+      shard_done.wait(lock, [&] { return is_done[i]; });
+    }
+
+    auto& shard = shards[i];
+    const auto& u = shard.u;
+    auto print = [&](std::ofstream& file, size_t index) {
+      file << count + index + 1 << " " << u << " " << shard.trivial_abel[index] << "\n";
+    };
 
-      trivial << count << " " << u << " " << v << "\n";
+    for (size_t index = 0; index < shard.trivial_abel.size(); ++index) {
+      print(trivial_abel, index);
     }
+    for (auto&& index : shard.no_simple_reduction) {
+      print(no_simple_reduction, index);
+    }
+    for (auto&& index : shard.no_conjugation_reduction) {
+      print(no_conjugation_reduction, index);
+    }
+    for (auto&& index : shard.trivial) {
+      print(trivial, index);
+    }
+    for (auto&& index : shard.undecided) {
+      print(undecided, index);
+    }
+    std::cout << shard.out;
+    std::cerr << shard.errors;
+
+    count += shard.trivial_abel.size();
+    filters.MergeStats(shard.filters);
+    shard = Shard();
   }
 
-}
\ No newline at end of file
+  for (auto&& worker : workers) {
+    worker.join();
+  }
+
+  for (auto&& filter : filters.stats()) {
+    std::cerr << "Filter " << filter.name << ": " << filter.hits << "/" << filter.calls << " hits, "
+        << std::chrono::duration<double>(filter.time).count() << "s" << std::endl;
+  }
+}
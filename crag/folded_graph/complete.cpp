@@ -2,14 +2,48 @@
 // Created by dpantele on 11/12/15.
 //
 
+#include <vector>
+
 #include "complete.h"
 
 namespace crag {
 
 void CompleteWith(FoldedGraph::Word r, size_t max_vertex_id, FoldedGraph* g) {
+  //Pushing a cycle never destroys the other ones, so cycles which are already in the graph can be skipped.
+  //If r labels a cycle at u, then the permutation by i letters labels a cycle at the i-th vertex of this cycle,
+  //therefore it is enough to read r just once from every vertex to find all existing permutations.
+  std::vector<uint64_t> existing_cycles(max_vertex_id, 0);
+  std::vector<size_t> cycle;
+  for (auto vertex = 0u; vertex < max_vertex_id; ++vertex) {
+    if ((*g)[vertex].IsMerged()) {
+      continue;
+    }
+
+    cycle.clear();
+    const FoldedGraph::Vertex* current = &(*g)[vertex];
+    FoldedGraph::Weight weight = 0;
+    for (auto rest = r; !rest.Empty(); rest.PopFront()) {
+      auto edge = current->edge(rest.GetFront());
+      if (!edge) {
+        break;
+      }
+      cycle.push_back(current->id());
+      weight += edge.weight();
+      current = &edge.terminus();
+    }
+
+    if (cycle.size() == r.size() && current->id() == vertex && g->modulus().Reduce(weight) == 0) {
+      for (size_t shift = 0; shift < cycle.size(); ++shift) {
+        if (cycle[shift] < max_vertex_id) {
+          existing_cycles[cycle[shift]] |= uint64_t{1} << shift;
+        }
+      }
+    }
+  }
+
   for (size_t shift = 0; shift < r.size(); ++shift, r.CyclicLeftShift()) {
     for (auto vertex = 0u; vertex < max_vertex_id; ++vertex) {
-      if ((*g)[vertex].IsMerged()) {
+      if ((*g)[vertex].IsMerged() || ((existing_cycles[vertex] >> shift) & 1u)) {
         continue;
       }
 
@@ -3,7 +3,6 @@
 //
 #include <set>
 #include <vector>
-#include <map>
 
 #include "folded_graph.h"
 #include "modulus.h"
@@ -12,32 +11,32 @@
 namespace crag {
 
 FoldedGraph::Vertex::const_iterator::EdgeDataAccess FoldedGraph::Vertex::edge(crag::FoldedGraph::Label l) const {
-  assert(!this->epsilon_);
-  assert(!edges_[l.AsInt()].terminus_ || !edges_[l.AsInt()].terminus_->epsilon_);
+  assert(!this->is_merged_);
+  assert(!edges_[l.AsInt()].terminus_ || !edges_[l.AsInt()].terminus_->is_merged_);
   return {edges_.begin() + l.AsInt(), l};
 }
 
 FoldedGraph::Vertex::iterator::EdgeDataAccess FoldedGraph::Vertex::edge(crag::FoldedGraph::Label l) {
-  assert(!this->epsilon_);
-  assert(!edges_[l.AsInt()].terminus_ || !edges_[l.AsInt()].terminus_->epsilon_);
+  assert(!this->is_merged_);
+  assert(!edges_[l.AsInt()].terminus_ || !edges_[l.AsInt()].terminus_->is_merged_);
   return {edges_.begin() + l.AsInt(), l};
 }
 
 
-void FoldedGraph::Vertex::Combine(FoldedGraph::Vertex* other, Weight this_shift, Modulus* modulus) {
+void FoldedGraph::Combine(FoldedGraph::Vertex* v1, FoldedGraph::Vertex* v2, FoldedGraph::Weight v1_shift) {
   std::vector<Vertex*> merged; //!< Recently merged vertices
 
-  this_shift = modulus->Reduce(this_shift);
-  merged.push_back(Merge(this, other, this_shift));
+  v1_shift = modulus_.Reduce(v1_shift);
+  merged.push_back(MergeVertices(v1, v2, v1_shift));
 
   while (!merged.empty()) {
     auto child_vertex = merged.back();
     merged.pop_back();
 
-    assert(child_vertex->epsilon_);
+    assert(child_vertex->is_merged_);
     assert(!child_vertex->merged_);
 
-    auto edge_to_root = FollowEdge(child_vertex->epsilon_);
+    auto edge_to_root = FollowEdge(EdgeData{child_vertex, 0});
     auto child_shift = edge_to_root.weight_;
     auto root_vertex = edge_to_root.terminus_;
 
@@ -57,7 +56,7 @@ void FoldedGraph::Vertex::Combine(FoldedGraph::Vertex* other, Weight this_shift,
           //while travelling from child to root, so only child_edge.weight_ - child_shift
           //is left
 
-          root_vertex->AddEdge(label, child_edge.terminus_, modulus->Reduce(child_edge.weight_ - child_shift));
+          root_vertex->AddEdge(label, child_edge.terminus_, modulus_.Reduce(child_edge.weight_ - child_shift));
         } else {
           //here we will have to merge two terminates
           child_edge = FollowEdge(child_edge);
@@ -67,15 +66,15 @@ void FoldedGraph::Vertex::Combine(FoldedGraph::Vertex* other, Weight this_shift,
           //now there is a path Child->Root->RootTerminus->ChildTerminus
           //the total weight of that path is child_shift + root_edge.weight_ + termini_shift, should be equal to child_edge
 
-          auto termini_shift = modulus->Reduce(child_edge.weight_ - child_shift - root_edge.weight_);
+          auto termini_shift = modulus_.Reduce(child_edge.weight_ - child_shift - root_edge.weight_);
 
           if (child_edge.terminus_ == root_edge.terminus_) {
             //there is no other way to make termini_shift == 0
             //other than change modulus_
-            modulus->EnsureEqual(termini_shift, 0);
+            modulus_.EnsureEqual(termini_shift, 0);
           } else {
             //termini shift in the formula above is for root_terminus->child_terminus
-            merged.push_back(Merge(root_edge.terminus_, child_edge.terminus_, termini_shift));
+            merged.push_back(MergeVertices(root_edge.terminus_, child_edge.terminus_, termini_shift));
           }
         }
       }
@@ -86,6 +85,10 @@ void FoldedGraph::Vertex::Combine(FoldedGraph::Vertex* other, Weight this_shift,
     child_vertex->merged_ = true;
 #endif
   }
+
+  if (root_->IsMerged()) {
+    root_ = &Parent(*root_);
+  }
 }
 
 /**
@@ -94,61 +97,38 @@ void FoldedGraph::Vertex::Combine(FoldedGraph::Vertex* other, Weight this_shift,
  *
  * A non-root vertex chosen is returned then.
  */
-FoldedGraph::Vertex* FoldedGraph::Vertex::Merge(
+FoldedGraph::Vertex* FoldedGraph::MergeVertices(
     FoldedGraph::Vertex* v1
     , FoldedGraph::Vertex* v2
     , FoldedGraph::Weight v1_shift) {
   //Merge should be called only on the root of trees
-  assert(!v1->epsilon_);
-  assert(!v2->epsilon_);
+  assert(!v1->is_merged_);
+  assert(!v2->is_merged_);
 
   //And looks like they always must be distinct
   assert(v1 != v2);
 
-  if (v1->equivalent_vertices_count_ < v2->equivalent_vertices_count_) {
-    //in this case we make v1 point to v2
-    v1->epsilon_.terminus_ = v2;
-    v1->epsilon_.weight_ = v1_shift;
-    v2->equivalent_vertices_count_ += v1->equivalent_vertices_count_;
+  if (equivalent_vertices_.Merge(v1->id(), v2->id()) == v2->id()) {
+    //in this case v1 points to v2
+    epsilon_weights_[v1->id()] = v1_shift;
+    v1->is_merged_ = true;
     return v1;
   } else {
     //otherwise v2 points to v1
-    v2->epsilon_.terminus_ = v1;
-    v2->epsilon_.weight_ = -v1_shift;
-    v1->equivalent_vertices_count_ += v2->equivalent_vertices_count_;
+    epsilon_weights_[v2->id()] = -v1_shift;
+    v2->is_merged_ = true;
     return v2;
   }
 }
 
-FoldedGraph::EdgeData FoldedGraph::Vertex::FollowEdge(const FoldedGraph::EdgeData& e) {
-  FoldedGraph::EdgeData result(e);
-
-  if (!result.terminus_->epsilon_) {
-    return result;
-  }
-
-  while (true) {
-    auto current = result.terminus_;
-    auto parent = current->epsilon_.terminus_;
-
-    if (!parent) {
-      return result;
-    }
-
-    auto grand_parent = parent->epsilon_.terminus_;
-
-    if (!grand_parent) {
-      result.terminus_ = parent;
-      result.weight_ += current->epsilon_.weight_;
-      return result;
-    }
-
-    current->epsilon_.terminus_ = grand_parent;
-    current->epsilon_.weight_ += parent->epsilon_.weight_;
-
-    result.terminus_ = grand_parent;
-    result.weight_ += current->epsilon_.weight_;
-  }
+FoldedGraph::EdgeData FoldedGraph::FollowEdge(FoldedGraph::EdgeData e) {
+  //every step of the path halving replaces an epsilon-edge by the path of two edges
+  auto root = equivalent_vertices_.Find(e.terminus_->id(), [this, &e](size_t vertex, size_t parent) {
+    epsilon_weights_[vertex] += epsilon_weights_[parent];
+    e.weight_ += epsilon_weights_[vertex];
+  });
+  e.terminus_ = &vertices_[root];
+  return e;
 }
 
 void FoldedGraph::Vertex::AddEdge(FoldedGraph::Label l, Vertex* terminus, FoldedGraph::Weight w) {
@@ -176,13 +156,6 @@ void FoldedGraph::Vertex::RemoveEdge(FoldedGraph::Label l) {
   inverse = EdgeData{};
 }
 
-void FoldedGraph::Combine(FoldedGraph::Vertex* v1, FoldedGraph::Vertex* v2, FoldedGraph::Weight v1_shift) {
-  v1->Combine(v2, v1_shift, &modulus_);
-  if (root_->IsMerged()) {
-    root_ = &(root_->Parent());
-  }
-}
-
 template <typename Path>
 Path ReadWord(
     const FoldedGraph::Word& w, decltype(std::declval<Path>().origin()) origin, CWord::size_type length_limit
@@ -242,10 +215,11 @@ void FoldedGraph::PushCycle(const FoldedGraph::Word& w, Vertex* origin, FoldedGr
 
 //! Make origin and terminus equal vertices, with weight on the epsilon-edge
 void EnsureEpsilon(
-    FoldedGraph::Vertex* origin, FoldedGraph::Vertex* terminus, FoldedGraph::Weight weight, Modulus* modulus) {
+    FoldedGraph::Vertex* origin, FoldedGraph::Vertex* terminus, FoldedGraph::Weight weight, FoldedGraph* graph
+    , Modulus* modulus) {
   if(origin != terminus) {
     //add an epsilon-edge from origin to terminus
-    origin->Combine(terminus, weight, modulus);
+    graph->Combine(origin, terminus, weight);
   } else {
     //or just adjust the modulus
     modulus->EnsureEqual(weight, 0);
@@ -255,19 +229,19 @@ void EnsureEpsilon(
 //! Make sure that @p origin and @p terminus are connected with an edge of weight @p weight nad label @p label
 void EnsureEdge(
     FoldedGraph::Label label, FoldedGraph::Vertex* origin, FoldedGraph::Vertex* terminus, FoldedGraph::Weight weight
-    , Modulus* modulus) {
+    , FoldedGraph* graph, Modulus* modulus) {
   {
     auto edge = origin->edge(label);
 
     if (edge) {
-      return EnsureEpsilon(&edge.terminus(), terminus, weight - edge.weight(), modulus);
+      return EnsureEpsilon(&edge.terminus(), terminus, weight - edge.weight(), graph, modulus);
     }
   }
 
   {
     auto inverse_edge = terminus->edge(label.Inverse());
     if (inverse_edge) {
-      return EnsureEpsilon(origin, &inverse_edge.terminus(), weight + inverse_edge.weight(), modulus);
+      return EnsureEpsilon(origin, &inverse_edge.terminus(), weight + inverse_edge.weight(), graph, modulus);
     }
   }
 
@@ -283,7 +257,7 @@ void FoldedGraph::EnsurePath(
   //halves is of required weight
 
   if (w.Empty()) {
-    EnsureEpsilon(origin, terminus, weight, &modulus_);
+    EnsureEpsilon(origin, terminus, weight, this, &modulus_);
   } else {
     auto from_origin = w;
     from_origin.PopBack(static_cast<Word::size_type>(from_origin.size() / 2));
@@ -299,79 +273,100 @@ void FoldedGraph::EnsurePath(
     auto terminus_path = PushWord(from_terminus, terminus);
 
     EnsureEdge(middle, &origin_path.terminus(), &terminus_path.terminus(),
-        weight - (origin_path.weight() - terminus_path.weight()), &modulus_);
+        weight - (origin_path.weight() - terminus_path.weight()), this, &modulus_);
   }
   if (root_->IsMerged()) {
-    root_ = &root_->Parent();
+    root_ = &Parent(*root_);
   }
 }
 
-boost::optional<FoldedGraph::Word> FindNontrivialPath(const FoldedGraph::Vertex& from, const FoldedGraph::Vertex& to) {
-  using Word = FoldedGraph::Word;
-  using Vertex = FoldedGraph::Vertex;
-  struct GraphPath {
-    Word w;
-    const Vertex* from;
-    const Vertex* to;
-
-    GraphPath Advance(const FoldedGraph::ConstEdge& edge) const {
-      assert(to->edge(edge.label()) == edge);
-      auto result = GraphPath{w, from, &edge.terminus()};
-      result.w.PushBack(edge.label());
-      return result;
-    }
-  };
-
-  std::map<const Vertex*, GraphPath> visited;
-  std::deque<GraphPath> next;
+namespace {
 
-  next.push_back(GraphPath{Word(), &from, &from});
+constexpr size_t kNone = static_cast<size_t>(-1); //!< Marks an unvisited vertex or a path without parent
 
-  if (from != to) {
-    next.push_back(GraphPath{Word(), &to, &to});
-  }
+//! Breadth-first search of a shortest non-trivial reduced path between two vertices
+/**
+ * The search is grown from both ends at once, and every vertex is expanded only when it is visited for the first time.
+ * Every visited path is kept only as a link to the path it extends, so that the label is built only for
+ * the path which is found in the end. Two paths meet when the latter of them is taken from the queue, hence
+ * the result may be one letter longer than the shortest path.
+ */
+class PathSearch {
+ public:
+  using Word = FoldedGraph::Word;
+  using Vertex = FoldedGraph::Vertex;
 
-  while(!next.empty()) {
-    auto& current = next.front();
-
-    auto first_visit = visited.emplace(current.to, current);
-    if (!first_visit.second) {
-      auto& existing = first_visit.first->second;
-      if (from == to || existing.from != current.from) {
-        //found path
-        assert(existing.w.Empty()
-               || current.w.Empty()
-               || existing.w.GetBack() != current.w.GetBack());
-        if (*current.from == from) {
-          auto result = current.w;
-          existing.w.Invert();
-          result.PushBack(existing.w);
-          return result;
-        } else {
-          assert(*current.from == to);
-          auto result = existing.w;
-          current.w.Invert();
-          result.PushBack(current.w);
-          return result;
+  PathSearch(const FoldedGraph& graph, const Vertex& from, const Vertex& to) {
+    steps_.push_back(Step{from.id(), kNone, FoldedGraph::Label(0), true});
+    if (from != to) {
+      steps_.push_back(Step{to.id(), kNone, FoldedGraph::Label(0), false});
+    }
+    std::vector<size_t> first_visit(graph.size(), kNone);
+
+    for (size_t current = 0; current < steps_.size(); ++current) {
+      auto step = steps_[current];
+      auto& existing = first_visit[step.vertex];
+      if (existing != kNone) {
+        if (from == to || steps_[existing].from_origin != step.from_origin) {
+          //found path
+          current_ = current;
+          existing_ = existing;
+          return;
         }
-      } else {
-        next.pop_front();
         continue;
       }
-    }
+      existing = current;
 
-    for(auto&& edge : *current.to) {
-      if (!current.w.Empty() && edge.label().Inverse() == current.w.GetBack()) {
-        continue;
+      for (auto&& edge : graph[step.vertex]) {
+        if (step.parent != kNone && edge.label().Inverse() == step.label) {
+          continue;
+        }
+        steps_.push_back(Step{edge.terminus().id(), current, edge.label(), step.from_origin});
       }
-      auto advanced = current.Advance(edge);
-      next.push_back(advanced);
     }
+  }
 
-    next.pop_front();
+  bool Found() const {
+    return current_ != kNone;
   }
-  return {};
-}
+
+  //! The label of the path which was found
+  Word Path() const {
+    assert(Found());
+    auto current = PathLabel(current_);
+    auto existing = PathLabel(existing_);
+    assert(existing.Empty() || current.Empty() || existing.GetBack() != current.GetBack());
+    if (steps_[current_].from_origin) {
+      current.PushBack(existing.Inverse());
+      return current;
+    } else {
+      existing.PushBack(current.Inverse());
+      return existing;
+    }
+  }
+
+ private:
+  struct Step {
+    size_t vertex;
+    size_t parent;
+    FoldedGraph::Label label; //!< The label of the last edge, if there is one
+    bool from_origin; //!< Whether the path starts at 'from' or at 'to'
+  };
+
+  std::vector<Step> steps_;
+  size_t current_ = kNone; //!< The step at which the paths from both ends met
+  size_t existing_ = kNone; //!< The step which visited the meeting vertex first
+
+  Word PathLabel(size_t step) const {
+    Word result;
+    for (; steps_[step].parent != kNone; step = steps_[step].parent) {
+      result.PushFront(steps_[step].label);
+    }
+    return result;
+  }
+};
+
+} //namespace
 
 boost::optional<FoldedGraph::Word> FoldedGraph::FindShortestPath(
     const FoldedGraph::Vertex& from, const FoldedGraph::Vertex& to) const {
@@ -379,20 +374,28 @@ boost::optional<FoldedGraph::Word> FoldedGraph::FindShortestPath(
     return Word();
   }
 
-  return FindNontrivialPath(from, to);
+  PathSearch search(*this, from, to);
+  if (!search.Found()) {
+    return {};
+  }
+  return search.Path();
 }
 
 boost::optional<FoldedGraph::Word> FoldedGraph::FindShortestCycle(const FoldedGraph::Vertex& base) const {
-  auto result = FindNontrivialPath(base, base);
-  if (result && result->Inverse() < result) {
-    return result->Inverse();
+  PathSearch search(*this, base, base);
+  if (!search.Found()) {
+    return {};
+  }
+  auto result = search.Path();
+  if (result.Inverse() < result) {
+    return result.Inverse();
   } else {
     return result;
   }
 }
 
 bool FoldedGraph::HasPath(const FoldedGraph::Vertex& from, const FoldedGraph::Vertex& to) const {
-  return static_cast<bool>(FindShortestPath(from, to));
+  return from == to || PathSearch(*this, from, to).Found();
 }
 
 bool FoldedGraph::HasPath(
@@ -415,7 +418,7 @@ bool FoldedGraph::HasPath(
 }
 
 bool FoldedGraph::HasCycle(const FoldedGraph::Vertex& base) const {
-  return static_cast<bool>(FindShortestCycle(base));
+  return PathSearch(*this, base, base).Found();
 }
 
 bool FoldedGraph::HasCycle(const FoldedGraph::Word& label, const FoldedGraph::Vertex& base) const {
@@ -9,8 +9,10 @@
 #include <cstddef>
 #include <deque>
 #include <stdint.h>
+#include <vector>
 
 #include <compressed_word/compressed_word.h>
+#include <disjoint_subsets/disjoint_sets.h>
 #include "modulus.h"
 #include <boost/optional.hpp>
 
@@ -139,7 +141,9 @@ class FoldedGraph
   class Vertex
   {
    public:
-    Vertex() = default;
+    explicit Vertex(size_t id)
+        : id_(id) {
+    }
 
     Vertex(const Vertex&) = delete;
 
@@ -152,11 +156,6 @@ class FoldedGraph
     //below is semi-public interface
     //in general, there should be no need to use this directly
 
-    //NOTE: if called with root() vertex, the root may be merged
-    //so this should be used really carefully
-    //most likely the best way is via PushCycle procedure
-    void Combine(FoldedGraph::Vertex* other, Weight this_shift, Modulus* modulus);
-
     void AddEdge(FoldedGraph::Label l, Vertex* terminus, FoldedGraph::Weight w);
 
     void RemoveEdge(FoldedGraph::Label l);
@@ -169,6 +168,11 @@ class FoldedGraph
       return this != &other;
     }
 
+    //! Index of the vertex in the graph, graph[v.id()] == v
+    size_t id() const {
+      return id_;
+    }
+
     using iterator = EdgesIteratorT<Vertex, std::array<EdgeData, Word::kAlphabetSize>::iterator>;
     using const_iterator = EdgesIteratorT<const Vertex, std::array<EdgeData, Word::kAlphabetSize>::const_iterator>;
 
@@ -193,47 +197,30 @@ class FoldedGraph
 
     //! Rarely used procedure to check if a vertex is merged into another one
     bool IsMerged() const {
-      return static_cast<bool>(epsilon_);
-    }
-
-    //! If IsMerged(), then the canonical representative is returned. Otherwise return *this
-    const Vertex& Parent() const {
-      return epsilon_ ? *FollowEdge(epsilon_).terminus_ : *this;
+      return is_merged_;
     }
 
-    Vertex& Parent() {
-      return epsilon_ ? *FollowEdge(epsilon_).terminus_ : *this;
-    }
    private:
     std::array<EdgeData, 2 * Word::kAlphabetSize> edges_;
+    size_t id_;
 
-
-    //fields below are used only in Combine() process
-    //and in general may be allocated externally
-    //in Combine()
-    //but it is not clear what will be more expensive here - memory is allocated for
-    //every vertex anyway
-
-    //! If @e epsilon_ is not null, it is followed any time this vertex is accessed
-    /** You could think of that as an implementation of disjoint set partition **/
-    EdgeData epsilon_{};
-    size_t equivalent_vertices_count_ = 1;
-
-    static Vertex* Merge(Vertex* v1, Vertex* v2, Weight v1_shift);
-
-    static EdgeData FollowEdge(const EdgeData& e);
+    //! Set when the vertex is merged into another one, see FoldedGraph::Parent()
+    bool is_merged_ = false;
 
 #ifndef NDEBUG
     //set to true when vertex was processed in Combine
     //if merged_ is true, the vertex should never have any edges in and out
     bool merged_ = false;
 #endif
+    friend class FoldedGraph;
     friend class FoldedGraphInternalChecks;
   };
 
   FoldedGraph()
-      : vertices_(1)
-      , root_(&vertices_.front()) {
+      : vertices_()
+      , equivalent_vertices_()
+      , epsilon_weights_()
+      , root_(&CreateVertex()) {
   }
 
   Vertex& root() {
@@ -241,7 +228,17 @@ class FoldedGraph
   }
 
   const Vertex& root() const {
-    return root_->Parent();
+    return Parent(*root_);
+  }
+
+  //! If @p v IsMerged(), then the canonical representative is returned. Otherwise return @p v
+  Vertex& Parent(const Vertex& v) {
+    //the path is halved through FollowEdge, so that the epsilon-weights are moved with the links
+    return *FollowEdge(EdgeData{&vertices_[v.id()], 0}).terminus_;
+  }
+
+  const Vertex& Parent(const Vertex& v) const {
+    return vertices_[equivalent_vertices_.Find(v.id())];
   }
 
   template <typename BaseIter>
@@ -331,10 +328,15 @@ class FoldedGraph
   }
 
   Vertex& CreateVertex() {
-    vertices_.emplace_back();
+    vertices_.emplace_back(vertices_.size());
+    equivalent_vertices_.Add();
+    epsilon_weights_.push_back(0);
     return vertices_.back();
   }
 
+  //! Merges @p v2 into @p v1 and folds the graph, the edges from @p v1 get @p v1_shift added to their weight
+  //NOTE: root() may be merged into another vertex
+  //most likely the best way is via PushCycle procedure
   void Combine(Vertex* v1, Vertex* v2, Weight v1_shift);
 
   const Modulus& modulus() const {
@@ -412,8 +414,19 @@ class FoldedGraph
 
  private:
   std::deque<Vertex> vertices_;
+
+  //! Merged vertices are linked by epsilon-edges to the canonical ones, they are followed any time a vertex is accessed
+  DisjointSets<size_t> equivalent_vertices_;
+  std::vector<Weight> epsilon_weights_; //!< Weight of the epsilon-edge to the parent, zero for the roots
+
   Vertex* root_; //!< We need explicit root since vertices_.front() may be merged
 
+  //! Links the roots @p v1 and @p v2 by an epsilon-edge, returns the one which is not a root anymore
+  Vertex* MergeVertices(Vertex* v1, Vertex* v2, Weight v1_shift);
+
+  //! Replaces the terminus of @p e by its canonical vertex and adjusts the weight
+  EdgeData FollowEdge(EdgeData e);
+
   Modulus modulus_;
 
   friend class FoldedGraphInternalChecks;
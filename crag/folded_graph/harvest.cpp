@@ -5,6 +5,8 @@
 #include <algorithm>
 #include <deque>
 
+#include <compressed_word/tuple_normal_form.h>
+
 #include "harvest.h"
 
 namespace crag {
@@ -41,6 +43,52 @@ void MergeRanges(
 }
 
 
+//! Set of pairs (vertex, weight), is used to check if a path can reach a vertex with the given weight
+/**
+ * Open addressing with linear probing, since it is built once for every harvested vertex
+ */
+class ReachedWeights {
+ public:
+  explicit ReachedWeights(size_t size) {
+    size_t capacity = 16;
+    while (capacity < 2 * size) {
+      capacity *= 2;
+    }
+    slots_.resize(capacity, Slot{nullptr, 0});
+    mask_ = capacity - 1;
+  }
+
+  void Insert(const Vertex* vertex, Weight weight) {
+    auto position = Find(vertex, weight);
+    slots_[position] = Slot{vertex, weight};
+  }
+
+  bool Contains(const Vertex* vertex, Weight weight) const {
+    return slots_[Find(vertex, weight)].vertex_ != nullptr;
+  }
+
+ private:
+  struct Slot {
+    const Vertex* vertex_;
+    Weight weight_;
+  };
+
+  std::vector<Slot> slots_;
+  size_t mask_;
+
+  //! Returns either position of (vertex, weight) or of the empty slot where it should be placed
+  size_t Find(const Vertex* vertex, Weight weight) const {
+    auto hash = reinterpret_cast<uintptr_t>(vertex) * 0x9E3779B97F4A7C15ull
+        ^ static_cast<uint64_t>(weight) * 0xC2B2AE3D27D4EB4Full;
+    auto position = static_cast<size_t>(hash ^ (hash >> 32)) & mask_;
+    while (slots_[position].vertex_ != nullptr
+        && (slots_[position].vertex_ != vertex || slots_[position].weight_ != weight)) {
+      position = (position + 1) & mask_;
+    }
+    return position;
+  }
+};
+
 void Harvest(
     const FoldedGraph& graph
     , Word::size_type k
@@ -141,6 +189,31 @@ void Harvest(
     });
   }
 
+  //prefix which reaches some vertex with weight w may be concatenated only with a suffix which reaches the same
+  //vertex with weight w - weight. Most of the halves have no such counterpart, and they are dropped before sorting
+  {
+    ReachedWeights suffix_weights(suffixes.size());
+    for (auto&& suffix : suffixes) {
+      suffix_weights.Insert(suffix.terminus_, suffix.weight_);
+    }
+
+    ReachedWeights prefix_weights(prefixes.size());
+    auto prefixes_end = std::remove_if(prefixes.begin(), prefixes.end(), [&](const Path& prefix) {
+      auto needed_suffix_weight = graph.modulus().Reduce(prefix.weight_ - weight);
+      if (!suffix_weights.Contains(prefix.terminus_, needed_suffix_weight)) {
+        return true;
+      }
+      prefix_weights.Insert(prefix.terminus_, needed_suffix_weight);
+      return false;
+    });
+    prefixes.erase(prefixes_end, prefixes.end());
+
+    auto suffixes_end = std::remove_if(suffixes.begin(), suffixes.end(), [&](const Path& suffix) {
+      return !prefix_weights.Contains(suffix.terminus_, suffix.weight_);
+    });
+    suffixes.erase(suffixes_end, suffixes.end());
+  }
+
   //we will merge prefixes and suffixes so that they have the same terminus
   //and also we will look for the path where prefix.w_ + suffix_.w_ is equal
   //to @param w
@@ -365,4 +438,107 @@ std::vector<FoldedGraph::Word> Harvest(FoldedGraph::Word::size_type k, FoldedGra
   return result;
 }
 
-}
\ No newline at end of file
+std::vector<Word> HarvestLeastRotations(Word::size_type k, Weight weight, FoldedGraph* graph) {
+  //pruning the paths which are not least rotations would require to read every cycle from the vertex where
+  //its least rotation starts, and so the edges of harvested vertices could not be removed. That makes the
+  //harvest much slower, so the cycles are rotated when they are already collected
+  auto result = Harvest(k, weight, graph);
+
+  for (auto&& word : result) {
+    word = LeastCyclicPermutation(word);
+  }
+
+  std::sort(result.begin(), result.end());
+  auto unique_end = std::unique(result.begin(), result.end());
+  result.erase(unique_end, result.end());
+
+  return result;
+}
+
+std::vector<double> EstimateClosedWalks(const FoldedGraph& graph, Word::size_type k, size_t samples_count) {
+  std::vector<const Vertex*> vertices;
+  for (auto&& vertex : graph) {
+    vertices.push_back(&vertex);
+  }
+
+  std::vector<double> result(k + 1u, 0.);
+  result[0] = vertices.size();
+  if (k == 0 || vertices.empty() || samples_count == 0) {
+    return result;
+  }
+
+  //walks[m][4 * v + l] is the number of non-backtracking walks of length m from the current base which
+  //end at the vertex v with an edge labeled l. Every closed walk is split into two halves the same way
+  //Harvest does that, so that only the vertices at the distance of ceil(k / 2.) are visited
+  static constexpr size_t kLabels = 2 * Word::kAlphabetSize;
+  auto half_length = static_cast<size_t>(ceil(k / 2.));
+  std::vector<std::vector<double>> walks(half_length + 1, std::vector<double>(kLabels * graph.size(), 0.));
+  std::vector<std::vector<size_t>> reached(half_length + 1);
+
+  auto stride = std::max<size_t>(1, vertices.size() / samples_count);
+  size_t sampled = 0;
+  for (size_t base_position = 0; base_position < vertices.size(); base_position += stride) {
+    ++sampled;
+    const Vertex& base = *vertices[base_position];
+
+    for (auto&& edge : base) {
+      auto position = kLabels * edge.terminus().id() + edge.label().AsInt();
+      walks[1][position] += 1;
+      reached[1].push_back(position);
+    }
+
+    for (size_t length = 1; length < half_length; ++length) {
+      for (auto position : reached[length]) {
+        Word::Letter last_label(static_cast<unsigned short>(position % kLabels));
+        for (auto&& edge : graph[position / kLabels]) {
+          if (edge.label() == last_label.Inverse()) {
+            continue;
+          }
+          auto next_position = kLabels * edge.terminus().id() + edge.label().AsInt();
+          if (walks[length + 1][next_position] == 0) {
+            reached[length + 1].push_back(next_position);
+          }
+          walks[length + 1][next_position] += walks[length][position];
+        }
+      }
+    }
+
+    //walks of length 1 are loops, the other ones are prefix of length ceil(l/2) and inverted suffix of length floor(l/2)
+    for (auto&& edge : base) {
+      if (edge.terminus() == base) {
+        result[1] += 1;
+      }
+    }
+
+    for (size_t length = 2; length <= k; ++length) {
+      auto& prefixes = walks[(length + 1) / 2];
+      auto& suffixes = walks[length / 2];
+      for (auto position : reached[length / 2]) {
+        //prefix and suffix can't end with the same edge, otherwise the concatenation is not reduced
+        auto vertex_begin = position - position % kLabels;
+        double prefixes_count = 0;
+        for (auto label = 0u; label < kLabels; ++label) {
+          if (vertex_begin + label != position) {
+            prefixes_count += prefixes[vertex_begin + label];
+          }
+        }
+        result[length] += suffixes[position] * prefixes_count;
+      }
+    }
+
+    for (size_t length = 1; length <= half_length; ++length) {
+      for (auto position : reached[length]) {
+        walks[length][position] = 0;
+      }
+      reached[length].clear();
+    }
+  }
+
+  for (size_t length = 1; length <= k; ++length) {
+    result[length] *= static_cast<double>(vertices.size()) / sampled;
+  }
+
+  return result;
+}
+
+}
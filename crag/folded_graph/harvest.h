@@ -38,6 +38,22 @@ void Harvest(
 //! The main harvest, which consumes @p graph and produces the list of all cycles of wight @p weight up to length @p k
 std::vector<FoldedGraph::Word> Harvest(FoldedGraph::Word::size_type k, FoldedGraph::Weight weight, FoldedGraph* graph);
 
+//! Same as the main harvest, but every cycle is presented only by its least cyclic permutation
+/**
+ * The result is sorted and has no two words which are cyclic permutations of each other.
+ */
+std::vector<FoldedGraph::Word> HarvestLeastRotations(
+    FoldedGraph::Word::size_type k, FoldedGraph::Weight weight, FoldedGraph* graph);
+
+//! Estimates the number of non-backtracking closed walks of every length up to @p k
+/**
+ * The walks are counted exactly at @p samples_count evenly spaced vertices, and then the counts are scaled to the
+ * whole graph. Weights are ignored, so this is an upper bound on the work Harvest(k, weight, graph) has to do rather
+ * than on the number of words it returns. The i-th element of the result corresponds to the walks of length i.
+ */
+std::vector<double> EstimateClosedWalks(
+    const FoldedGraph& graph, FoldedGraph::Word::size_type k, size_t samples_count = 16);
+
 }
 
 
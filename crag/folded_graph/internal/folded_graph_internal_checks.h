@@ -44,7 +44,7 @@ class FoldedGraphInternalChecks
     using ::testing::AssertionFailure;
     using ::testing::AssertionSuccess;
 
-    if (vertex.epsilon_) {
+    if (vertex.IsMerged()) {
 #ifndef NDEBUG
       if (!vertex.merged_) {
         return AssertionFailure() << "Vertex was merged but was not processed";
@@ -76,6 +76,17 @@ class FoldedGraphInternalChecks
   }
 
 
+  //! Weight of the path of epsilon-edges from @p v to its root, without modifying the graph
+  static FoldedGraph::Weight WeightToRoot(const FoldedGraph& g, const FoldedGraph::Vertex& v) {
+    FoldedGraph::Weight weight = 0;
+    const FoldedGraph::Vertex* current = &v;
+    while (current->IsMerged()) {
+      weight += g.epsilon_weights_[current->id()];
+      current = &g.vertices_[g.equivalent_vertices_.ParentOf(current->id())];
+    }
+    return weight;
+  }
+
   static ::testing::AssertionResult Check(const FoldedGraph& g) {
     using ::testing::AssertionFailure;
     using ::testing::AssertionSuccess;
@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+
+#include "complete.h"
+#include "harvest.h"
+
+namespace crag { namespace {
+
+using Word = FoldedGraph::Word;
+
+//! CompleteWith as it is defined, without skipping the existing cycles
+void CompleteWithNaive(Word r, size_t max_vertex_id, FoldedGraph* g) {
+  for (size_t shift = 0; shift < r.size(); ++shift, r.CyclicLeftShift()) {
+    for (auto vertex = 0u; vertex < max_vertex_id; ++vertex) {
+      if (!(*g)[vertex].IsMerged()) {
+        g->PushCycle(r, &(*g)[vertex], 0);
+      }
+    }
+  }
+}
+
+size_t LiveVertices(const FoldedGraph& g) {
+  return static_cast<size_t>(std::distance(g.begin(), g.end()));
+}
+
+TEST(CompleteWith, CompareWithNaive) {
+  std::mt19937_64 engine(17);
+  RandomWord rw(1, 8);
+
+  for (auto repeat = 0u; repeat < 300u; ++repeat) {
+    auto u = rw(engine);
+    auto v = rw(engine);
+    u.CyclicReduce();
+    v.CyclicReduce();
+
+    FoldedGraph g;
+    FoldedGraph g_naive;
+    g.PushCycle(u, 1);
+    g_naive.PushCycle(u, 1);
+    for (auto round = 0u; round < 3u; ++round) {
+      CompleteWith(v, &g);
+      CompleteWithNaive(v, g_naive.size(), &g_naive);
+
+      ASSERT_EQ(g_naive.size(), g.size()) << u << " " << v;
+      ASSERT_EQ(LiveVertices(g_naive), LiveVertices(g)) << u << " " << v;
+      ASSERT_EQ(g_naive.modulus().modulus(), g.modulus().modulus()) << u << " " << v;
+    }
+
+    ASSERT_EQ(Harvest(10, 1, &g_naive), Harvest(10, 1, &g)) << u << " " << v;
+  }
+}
+
+} }
@@ -103,13 +103,13 @@ TEST(FoldedGraph, PacmanFold) {
 
   g.Combine(v1, v3, 0);
 
-  auto v5 = &v1->Parent();
+  auto v5 = &g.Parent(*v1);
   EXPECT_TRUE(v5 == v1 || v5 == v3);
-  EXPECT_TRUE(v1->Parent() == v3->Parent());
+  EXPECT_TRUE(g.Parent(*v1) == g.Parent(*v3));
 
-  auto v6 = &v2->Parent();
+  auto v6 = &g.Parent(*v2);
   EXPECT_TRUE(v6 == v2 || v6 == v4);
-  EXPECT_TRUE(v2->Parent() == v4->Parent());
+  EXPECT_TRUE(g.Parent(*v2) == g.Parent(*v4));
 
   EXPECT_TRUE(v5->edge(Label('x')));
   EXPECT_FALSE(v5->edge(Label('X')));
@@ -125,6 +125,36 @@ TEST(FoldedGraph, PacmanFold) {
   EXPECT_EQ(0, v5->edge(Label('x')).weight() + v6->edge(Label('Y')).weight());
 }
 
+TEST(FoldedGraph, ParentKeepsEpsilonWeights) {
+  FoldedGraph g;
+  auto v0 = &g.root();
+  auto v1 = &g.CreateVertex();
+  auto v2 = &g.CreateVertex();
+  auto v3 = &g.CreateVertex();
+  auto v4 = &g.CreateVertex();
+  v1->AddEdge(Label('x'), v4, 5);
+
+  //the equal subsets are merged into the first one, so v1 ends up two epsilon-edges away from v2
+  g.Combine(v0, v1, 1);
+  g.Combine(v2, v3, 2);
+  g.Combine(v2, v0, 3);
+
+  ASSERT_EQ(*v2, g.root());
+  auto v1_weight = FoldedGraphInternalChecks::WeightToRoot(g, *v1);
+  EXPECT_EQ(-4, v1_weight);
+  EXPECT_EQ(5 - v1_weight, g.root().edge(Label('x')).weight());
+
+  //the path halving should not change the weights of the paths to the root
+  EXPECT_EQ(*v2, g.Parent(*v1));
+  EXPECT_EQ(*v2, g.Parent(*v0));
+  EXPECT_EQ(v1_weight, FoldedGraphInternalChecks::WeightToRoot(g, *v1));
+  EXPECT_EQ(-3, FoldedGraphInternalChecks::WeightToRoot(g, *v0));
+  EXPECT_EQ(-2, FoldedGraphInternalChecks::WeightToRoot(g, *v3));
+  EXPECT_EQ(5 - v1_weight, g.root().edge(Label('x')).weight());
+  EXPECT_EQ(v1_weight - 5, v4->edge(Label('X')).weight());
+  EXPECT_TRUE(FoldedGraphInternalChecks::Check(g));
+}
+
 TEST(FoldedGraph, PacmanFoldModulus) {
   FoldedGraph g;
   auto v1 = &g.CreateVertex();
@@ -141,13 +171,13 @@ TEST(FoldedGraph, PacmanFoldModulus) {
 
   g.Combine(v1, v3, 0);
 
-  auto v5 = &v1->Parent();
+  auto v5 = &g.Parent(*v1);
   EXPECT_TRUE(v5 == v1 || v5 == v3);
-  EXPECT_TRUE(v1->Parent() == v3->Parent());
+  EXPECT_TRUE(g.Parent(*v1) == g.Parent(*v3));
 
-  auto v6 = &v2->Parent();
+  auto v6 = &g.Parent(*v2);
   EXPECT_TRUE(v6 == v2 || v6 == v4);
-  EXPECT_TRUE(v2->Parent() == v4->Parent());
+  EXPECT_TRUE(g.Parent(*v2) == g.Parent(*v4));
 
   EXPECT_TRUE(v5->edge(Label('x')));
   EXPECT_FALSE(v5->edge(Label('X')));
@@ -509,6 +539,55 @@ TEST(GraphShortestPath, Example4) {
   EXPECT_EQ(Word("XY"), *cycle);
 }
 
+//! The shortest non-empty word which labels a path from @p from to @p to, found by exhaustive search
+boost::optional<Word> ShortestPathNaive(
+    const FoldedGraph& g, const FoldedGraph::Vertex& from, const FoldedGraph::Vertex& to, Word::size_type max_length) {
+  for (Word w(1, Label(0)); w.size() <= max_length; w.ToNextWord()) {
+    if (g.HasPath(w, from, to)) {
+      return w;
+    }
+  }
+  return {};
+}
+
+TEST(GraphShortestPath, CompareWithNaive) {
+  static const Word::size_type kMaxLength = 8;
+  std::mt19937_64 engine(17);
+  RandomWord rw(2, 5);
+
+  for (auto repeat = 0u; repeat < 100u; ++repeat) {
+    FoldedGraph g;
+    for (auto j = 0u; j < 3u; ++j) {
+      g.PushCycle(rw(engine));
+    }
+    g.CreateVertex();
+
+    std::uniform_int_distribution<size_t> random_vertex(0, g.size() - 1);
+    for (auto j = 0u; j < 10u; ++j) {
+      const auto& from = g[random_vertex(engine)];
+      const auto& to = g[random_vertex(engine)];
+      if (from.IsMerged() || to.IsMerged()) {
+        continue;
+      }
+
+      auto path = from == to ? g.FindShortestCycle(from) : g.FindShortestPath(from, to);
+      auto naive = ShortestPathNaive(g, from, to, kMaxLength);
+      EXPECT_EQ(static_cast<bool>(path), from == to ? g.HasCycle(from) : g.HasPath(from, to));
+      if (!path) {
+        EXPECT_FALSE(naive);
+        continue;
+      }
+      EXPECT_TRUE(g.HasPath(*path, from, to)) << *path;
+      if (naive) {
+        //paths from both ends are joined only when the second one is taken from the queue
+        EXPECT_LE(path->size(), naive->size() + 1u) << *path << " vs " << *naive;
+      } else {
+        EXPECT_GT(path->size(), kMaxLength);
+      }
+    }
+  }
+}
+
 
 }
 }
\ No newline at end of file
@@ -394,6 +394,86 @@ TEST(FoldedGraphHarvest, StressFullHarvestCompareWithNaive) {
 
 }
 
+TEST(FoldedGraphHarvest, StressLeastRotationsCompareWithNaive) {
+  static const auto kDuration = std::chrono::seconds(5);
+  static const auto kMinRepeat = 1000u;
+  static const unsigned int kWords = 4;
+  std::mt19937_64 engine(17);
+  RandomWord rw(2, 6);
+  std::discrete_distribution<Weight> random_weight({0.6, 0.4, 0.1});
+
+  auto begin = std::chrono::steady_clock::now();
+  auto repeat = 0ull;
+
+  while (std::chrono::steady_clock::now() - begin < kDuration || repeat < kMinRepeat) {
+    ++repeat;
+    std::vector<std::pair<Word, Weight>> words;
+    FoldedGraph g;
+    naive::NaiveFoldedGraph2 g_naive;
+    auto max_length = 0u;
+    for (auto j = 0u; j < kWords; ++j) {
+      words.emplace_back(rw(engine), random_weight(engine));
+      g.PushCycle(words.back().first, &g.root(), words.back().second);
+      g_naive.PushCycle(g_naive.root(), words.back().first, words.back().second);
+      if (words.back().first.size() > max_length) {
+        max_length = words.back().first.size();
+      }
+    }
+    g_naive.Fold();
+
+    auto harvest_folded = HarvestLeastRotations(max_length + 2, 1, &g);
+    auto harvest_naive = g_naive.Harvest(max_length + 2, 1);
+
+    for (auto& word : harvest_naive) {
+      word = MinCycle(word);
+    }
+    std::sort(harvest_naive.begin(), harvest_naive.end());
+    harvest_naive.erase(std::unique(harvest_naive.begin(), harvest_naive.end()), harvest_naive.end());
+
+    ASSERT_EQ(harvest_naive, harvest_folded) << "Pushed " << ::testing::PrintToString(words);
+  }
+  std::cout << std::string(13, ' ') << repeat << " repeats" << std::endl;
+}
+
+//! Number of non-backtracking walks of length @p length from @p from to @p to, with the previous edge @p last
+size_t CountWalks(const FoldedGraph::Vertex& from, const FoldedGraph::Vertex& to, size_t length, Label last) {
+  if (length == 0) {
+    return from == to ? 1 : 0;
+  }
+  size_t result = 0;
+  for (auto&& edge : from) {
+    if (edge.label() != last.Inverse()) {
+      result += CountWalks(edge.terminus(), to, length - 1, edge.label());
+    }
+  }
+  return result;
+}
 
+TEST(FoldedGraphHarvest, EstimateClosedWalksIsExactForAllSamples) {
+  std::mt19937_64 engine(17);
+  RandomWord rw(2, 6);
+
+  for (auto repeat = 0u; repeat < 100u; ++repeat) {
+    FoldedGraph g;
+    for (auto j = 0u; j < 3u; ++j) {
+      g.PushCycle(rw(engine), &g.root(), 1);
+    }
+
+    static const Word::size_type kLength = 8;
+    auto estimate = EstimateClosedWalks(g, kLength, g.size());
+
+    std::vector<double> expected(kLength + 1u, 0.);
+    for (auto&& vertex : g) {
+      expected[0] += 1;
+      for (auto&& edge : vertex) {
+        for (auto length = 1u; length <= kLength; ++length) {
+          expected[length] += CountWalks(edge.terminus(), vertex, length - 1, edge.label());
+        }
+      }
+    }
+
+    ASSERT_EQ(expected, estimate);
+  }
+}
 
-} }
\ No newline at end of file
+} }
@@ -0,0 +1,136 @@
+#include "pair_filters.h"
+
+#include <compressed_word/longest_common_subword_cyclic.h>
+#include <folded_graph/complete.h>
+#include <folded_graph/folded_graph.h>
+#include <folded_graph/harvest.h>
+
+namespace crag {
+
+bool HasTrivialAbelianisation(const CWord& u, const CWord& v) {
+  auto u_powers = u.ExponentSums();
+  auto v_powers = v.ExponentSums();
+  return std::abs(u_powers[0] * v_powers[1] - v_powers[0] * u_powers[1]) == 1;
+}
+
+boost::optional<CWordTuple<2>> CommonSubwordReduction(CWord u, CWord v) {
+  CWord::size_type u_begin, v_begin, common_length;
+  std::tie(u_begin, v_begin, common_length) = LongestCommonSubwordCyclic(u, v);
+  if (2 * common_length <= u.size() && 2 * common_length <= v.size()) {
+    return boost::none;
+  }
+
+  //now u = a u_1 and v = a v_1
+  u.CyclicLeftShift(u_begin);
+  v.CyclicLeftShift(v_begin);
+  auto u_1 = u;
+  u_1.PopFront(common_length);
+  auto v_1 = v;
+  v_1.PopFront(common_length);
+
+  if (2 * common_length > u.size()) {
+    //v u^{-1} = a v_1 u_1^{-1} a^{-1}
+    v_1.PushBack(u_1.Inverse());
+    v_1.CyclicReduce();
+    return CWordTuple<2>{u, v_1};
+  } else {
+    u_1.PushBack(v_1.Inverse());
+    u_1.CyclicReduce();
+    return CWordTuple<2>{u_1, v};
+  }
+}
+
+boost::optional<CWord> ConjugationLengthReduction(const CWord& u, const CWord& v) {
+  FoldedGraph g;
+  g.PushCycle(u, 1);
+  CompleteWith(v, &g);
+  CompleteWith(v, &g);
+  auto result = Harvest(u.size(), 1, &g);
+
+  for (auto&& u_p : result) {
+    if (u_p.size() > u.size()) {
+      break;
+    }
+    auto normal = ConjugationInverseNormalForm(u_p);
+    if (normal < u) {
+      return normal;
+    }
+  }
+
+  return boost::none;
+}
+
+void PairFilters::Add(std::string name, Filter filter) {
+  filters_.push_back(std::move(filter));
+  stats_.emplace_back();
+  stats_.back().name = std::move(name);
+}
+
+PairFilters::Verdict PairFilters::operator()(const CWordTuple<2>& pair, CWordTuple<2>* reduced, size_t* filter) {
+  for (size_t i = 0; i < filters_.size(); ++i) {
+    auto begin = std::chrono::steady_clock::now();
+    auto verdict = filters_[i](pair, reduced);
+    stats_[i].time += std::chrono::steady_clock::now() - begin;
+    ++stats_[i].calls;
+    if (verdict != Verdict::kPass) {
+      ++stats_[i].hits;
+      if (filter) {
+        *filter = i;
+      }
+      return verdict;
+    }
+  }
+  return Verdict::kPass;
+}
+
+void PairFilters::MergeStats(const PairFilters& other) {
+  assert(stats_.size() == other.stats_.size());
+  for (size_t i = 0; i < stats_.size(); ++i) {
+    assert(stats_[i].name == other.stats_[i].name);
+    stats_[i].calls += other.stats_[i].calls;
+    stats_[i].hits += other.stats_[i].hits;
+    stats_[i].time += other.stats_[i].time;
+  }
+}
+
+void AddCommonSubwordFilter(PairFilters* filters) {
+  using Verdict = PairFilters::Verdict;
+
+  filters->Add("common_subword", [](const CWordTuple<2>& pair, CWordTuple<2>* reduced) {
+    auto result = CommonSubwordReduction(pair[0], pair[1]);
+    //an empty word means that u and v are conjugate, which is never the case for the trivial group
+    if (!result || (*result)[0].Empty() || (*result)[1].Empty()) {
+      return Verdict::kPass;
+    }
+    *reduced = ConjugationInverseFlipNormalForm(*result);
+    return Verdict::kReduced;
+  });
+}
+
+void AddConjugationLengthFilter(PairFilters* filters) {
+  using Verdict = PairFilters::Verdict;
+
+  filters->Add("conjugation_length", [](const CWordTuple<2>& pair, CWordTuple<2>* reduced) {
+    if (auto u = ConjugationLengthReduction(pair[0], pair[1])) {
+      *reduced = ConjugationInverseFlipNormalForm(CWordTuple<2>{*u, pair[1]});
+      return Verdict::kReduced;
+    }
+    if (auto v = ConjugationLengthReduction(pair[1], pair[0])) {
+      *reduced = ConjugationInverseFlipNormalForm(CWordTuple<2>{pair[0], *v});
+      return Verdict::kReduced;
+    }
+    return Verdict::kPass;
+  });
+}
+
+void AddTrivialPresentationFilters(PairFilters* filters) {
+  using Verdict = PairFilters::Verdict;
+
+  filters->Add("trivial_abelianisation", [](const CWordTuple<2>& pair, CWordTuple<2>*) {
+    return HasTrivialAbelianisation(pair[0], pair[1]) ? Verdict::kPass : Verdict::kSkip;
+  });
+  AddCommonSubwordFilter(filters);
+  AddConjugationLengthFilter(filters);
+}
+
+}
@@ -0,0 +1,86 @@
+#ifndef ACC_PAIR_FILTERS_H
+#define ACC_PAIR_FILTERS_H
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include <compressed_word/tuple_normal_form.h>
+
+namespace crag {
+
+//! Check if the abelianisation of <x, y | u, v> is trivial, i.e. the exponent sums matrix has determinant \pm 1
+bool HasTrivialAbelianisation(const CWord& u, const CWord& v);
+
+//! Shorten one of the words if they have a long common cyclic subword
+/**
+ * If u = a u_1 and v = a v_1 up to a cyclic permutation and a is longer than a half of u, then v can be replaced by
+ * the cyclically reduced v_1 u_1^{-1}, which is shorter than v. The same is done for u if a is longer than a half of v.
+ */
+boost::optional<CWordTuple<2>> CommonSubwordReduction(CWord u, CWord v);
+
+//! Find a word of length at most |u|, less than u in the normal form, which is obtained from u by ACM-moves with v
+boost::optional<CWord> ConjugationLengthReduction(const CWord& u, const CWord& v);
+
+//! Ordered sequence of cheap tests, which are run on a pair before the expensive ones
+/**
+ * Filters are applied one by one until some of them finds out something about the pair. The number of calls,
+ * hits and time spent is collected for every filter.
+ */
+class PairFilters {
+ public:
+  enum class Verdict {
+    kPass,    //!< Nothing is known about the pair
+    kSkip,    //!< The pair does not need to be processed
+    kReduced, //!< The pair is AC-equivalent to a smaller pair
+  };
+
+  //! Filter may write a smaller equivalent pair in normal form to the second parameter when returns kReduced
+  using Filter = std::function<Verdict(const CWordTuple<2>&, CWordTuple<2>*)>;
+
+  struct FilterStats {
+    std::string name;
+    size_t calls = 0;
+    size_t hits = 0;
+    std::chrono::steady_clock::duration time{};
+  };
+
+  void Add(std::string name, Filter filter);
+
+  //! If @p filter is not null, the index of the filter which returned the verdict is written there unless it is kPass
+  Verdict operator()(const CWordTuple<2>& pair, CWordTuple<2>* reduced, size_t* filter = nullptr);
+
+  const std::vector<FilterStats>& stats() const {
+    return stats_;
+  }
+
+  //! Add the counters of @p other, which must be a copy of this pipeline
+  void MergeStats(const PairFilters& other);
+
+ private:
+  std::vector<Filter> filters_;
+  std::vector<FilterStats> stats_;
+};
+
+//! Append CommonSubwordReduction, which is cheap enough to run on every pair
+void AddCommonSubwordFilter(PairFilters* filters);
+
+//! Append ConjugationLengthReduction of each of the words
+/**
+ * It builds a folded graph and harvests it twice, so it is not cheap compared to the other filters
+ */
+void AddConjugationLengthFilter(PairFilters* filters);
+
+//! Append the tests used in the search of trivial presentations
+/**
+ * These are the abelianisation check, which skips the pair, and the two reductions above. The abelianisation check
+ * doesn't make sense for the pairs obtained by AC-moves, which all present the same group.
+ */
+void AddTrivialPresentationFilters(PairFilters* filters);
+
+}
+
+#endif //ACC_PAIR_FILTERS_H
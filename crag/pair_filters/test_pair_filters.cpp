@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+
+#include "pair_filters.h"
+
+namespace crag { namespace {
+
+using Verdict = PairFilters::Verdict;
+
+TEST(PairFilters, TrivialAbelianisation) {
+  EXPECT_TRUE(HasTrivialAbelianisation(CWord("x"), CWord("y")));
+  EXPECT_TRUE(HasTrivialAbelianisation(CWord("xY"), CWord("xxY")));
+  EXPECT_TRUE(HasTrivialAbelianisation(CWord("xyXYx"), CWord("y")));
+  EXPECT_FALSE(HasTrivialAbelianisation(CWord("xx"), CWord("y")));
+  EXPECT_FALSE(HasTrivialAbelianisation(CWord("xyXY"), CWord("xy")));
+}
+
+TEST(PairFilters, CommonSubwordReduction) {
+  auto reduced = CommonSubwordReduction(CWord("xxxy"), CWord("xxxY"));
+  ASSERT_TRUE(reduced);
+  EXPECT_EQ(CWord("xxxy"), (*reduced)[0]);
+  EXPECT_EQ(CWord("YY"), (*reduced)[1]);
+
+  //the common part xyx is exactly a half of u, so u is shortened this time
+  reduced = CommonSubwordReduction(CWord("xyxyyy"), CWord("xyx"));
+  ASSERT_TRUE(reduced);
+  EXPECT_EQ(CWord("yyy"), (*reduced)[0]);
+  EXPECT_EQ(3u, (*reduced)[1].size());
+
+  EXPECT_FALSE(CommonSubwordReduction(CWord("xy"), CWord("XY")));
+  EXPECT_FALSE(CommonSubwordReduction(CWord("xxyy"), CWord("xxYY")));
+}
+
+TEST(PairFilters, ConjugationLengthReduction) {
+  auto reduced = ConjugationLengthReduction(CWord("xxy"), CWord("x"));
+  ASSERT_TRUE(reduced);
+  EXPECT_GT(3u, reduced->size());
+
+  EXPECT_FALSE(ConjugationLengthReduction(CWord("x"), CWord("y")));
+}
+
+TEST(PairFilters, Pipeline) {
+  PairFilters filters;
+  filters.Add("skip_empty", [](const CWordTuple<2>& pair, CWordTuple<2>*) {
+    return pair[0].Empty() ? Verdict::kSkip : Verdict::kPass;
+  });
+  filters.Add("drop_first", [](const CWordTuple<2>& pair, CWordTuple<2>* reduced) {
+    if (pair[0].size() < 2) {
+      return Verdict::kPass;
+    }
+    *reduced = pair;
+    (*reduced)[0].PopFront();
+    return Verdict::kReduced;
+  });
+
+  CWordTuple<2> reduced;
+  EXPECT_EQ(Verdict::kSkip, filters(CWordTuple<2>{CWord(), CWord("x")}, &reduced));
+  EXPECT_EQ(Verdict::kReduced, filters(CWordTuple<2>{CWord("xy"), CWord("x")}, &reduced));
+  EXPECT_EQ(CWord("y"), reduced[0]);
+  EXPECT_EQ(Verdict::kPass, filters(CWordTuple<2>{CWord("y"), CWord("x")}, &reduced));
+
+  ASSERT_EQ(2u, filters.stats().size());
+  EXPECT_EQ("skip_empty", filters.stats()[0].name);
+  EXPECT_EQ(3u, filters.stats()[0].calls);
+  EXPECT_EQ(1u, filters.stats()[0].hits);
+  EXPECT_EQ(2u, filters.stats()[1].calls);
+  EXPECT_EQ(1u, filters.stats()[1].hits);
+
+  auto copy = filters;
+  copy(CWordTuple<2>{CWord("y"), CWord("x")}, &reduced);
+  filters.MergeStats(copy);
+  EXPECT_EQ(7u, filters.stats()[0].calls);
+  EXPECT_EQ(2u, filters.stats()[0].hits);
+  EXPECT_EQ(5u, filters.stats()[1].calls);
+}
+
+TEST(PairFilters, TrivialPresentationFilters) {
+  PairFilters filters;
+  AddTrivialPresentationFilters(&filters);
+
+  CWordTuple<2> reduced;
+  size_t filter = 100;
+  EXPECT_EQ(Verdict::kSkip, filters(CWordTuple<2>{CWord("xx"), CWord("y")}, &reduced, &filter));
+  EXPECT_EQ("trivial_abelianisation", filters.stats()[filter].name);
+  EXPECT_EQ(Verdict::kReduced, filters(CWordTuple<2>{CWord("xxxy"), CWord("xxxyx")}, &reduced, &filter));
+  EXPECT_EQ("common_subword", filters.stats()[filter].name);
+  EXPECT_EQ(reduced, ConjugationInverseFlipNormalForm(CWordTuple<2>{CWord("xxxy"), CWord("x")}));
+  EXPECT_EQ(Verdict::kPass, filters(CWordTuple<2>{CWord("x"), CWord("y")}, &reduced, &filter));
+  EXPECT_EQ("common_subword", filters.stats()[filter].name);
+}
+
+TEST(PairFilters, CommonSubwordFilter) {
+  PairFilters filters;
+  AddCommonSubwordFilter(&filters);
+
+  //the pairs of nontrivial groups are not skipped
+  CWordTuple<2> reduced;
+  EXPECT_EQ(Verdict::kPass, filters(CWordTuple<2>{CWord("xx"), CWord("y")}, &reduced));
+  EXPECT_EQ(Verdict::kReduced, filters(CWordTuple<2>{CWord("xxxy"), CWord("xxxyx")}, &reduced));
+  EXPECT_EQ(reduced, ConjugationInverseFlipNormalForm(CWordTuple<2>{CWord("xxxy"), CWord("x")}));
+  ASSERT_EQ(1u, filters.stats().size());
+  EXPECT_EQ("common_subword", filters.stats()[0].name);
+}
+
+}}